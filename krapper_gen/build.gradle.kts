@@ -52,6 +52,43 @@ kotlin {
     hostTarget.apply {
         binaries {
             executable()
+            // Headless generator benchmark, see the benchmark task below.
+            executable("bench", listOf(RELEASE)) {
+                entryPoint = "com.monkopedia.krapper.bench.main"
+                runTaskProvider?.configure {
+                    workingDir = rootDir
+                    args(
+                        "--output",
+                        "krapper_gen/build/benchmark/results.json"
+                    )
+                    if (project.hasProperty("updateBenchmarkBaseline")) {
+                        args("--update-baseline")
+                    }
+                    doFirst {
+                        file("build/benchmark").mkdirs()
+                    }
+                }
+                val bench = this
+                tasks.register<Exec>("scaleBenchmark") {
+                    group = "verification"
+                    description = "Times each generator phase on synthetic headers of 1k-50k " +
+                        "declarations to find super-linear phases"
+                    dependsOn(bench.linkTaskProvider)
+                    workingDir = rootDir
+                    args(
+                        "--suite", "none",
+                        "--iterations", "1",
+                        "--output", "krapper_gen/build/benchmark/scale.json"
+                    )
+                    for (size in listOf(1000, 5000, 10000, 25000, 50000)) {
+                        args("--synthetic", size)
+                    }
+                    doFirst {
+                        file("build/benchmark").mkdirs()
+                        executable = bench.outputFile.absolutePath
+                    }
+                }
+            }
         }
         compilations.all {
             compileTaskProvider.configure {
@@ -85,6 +122,12 @@ kotlin {
     }
 }
 
+tasks.register("benchmark") {
+    group = "verification"
+    description = "Times each generator phase on testlib and the v8 headers against the baseline"
+    dependsOn("runBenchReleaseExecutableNative")
+}
+
 tasks.withType<org.jetbrains.kotlin.gradle.tasks.KotlinCompile>().all {
     compilerOptions {
         jvmTarget.set(org.jetbrains.kotlin.gradle.dsl.JvmTarget.JVM_11)
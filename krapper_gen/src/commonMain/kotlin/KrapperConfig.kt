@@ -29,6 +29,22 @@ enum class ReferencePolicy {
     INCLUDE_MISSING
 }
 
+/**
+ * Instrumentation compiled into the generated C++ wrappers. COUNT and TIME keep in-process
+ * stats (see `<module>_dump_stats`), PROBES emits USDT markers for perf/bpftrace instead.
+ */
+enum class CallInstrumentation {
+    NONE,
+    COUNT,
+    TIME,
+    PROBES;
+
+    val hasStats: Boolean
+        get() = this == COUNT || this == TIME
+}
+
+const val DEFAULT_LANGUAGE_STANDARD = "c++14"
+
 @Serializable
 data class KrapperConfig(
     val pkg: String,
@@ -36,5 +52,17 @@ data class KrapperConfig(
     val moduleName: String,
     val errorPolicy: ErrorPolicy,
     val referencePolicy: ReferencePolicy,
-    val debug: Boolean
+    val debug: Boolean,
+    /**
+     * Write a Chrome trace of the generator phases next to the generated output.
+     */
+    val trace: Boolean = false,
+    /**
+     * Count (and optionally time) every call made through the generated wrappers.
+     */
+    val instrumentation: CallInstrumentation = CallInstrumentation.NONE,
+    /**
+     * Language standard the headers are parsed and the wrappers compiled with, e.g. `c++17`.
+     */
+    val languageStandard: String = DEFAULT_LANGUAGE_STANDARD
 )
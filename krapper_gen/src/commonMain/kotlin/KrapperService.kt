@@ -60,4 +60,20 @@ interface IndexedService : RpcService {
 
     @KsMethod("/output")
     suspend fun writeTo(output: String)
+
+    /**
+     * Writes the resolved model to [output], so it can be loaded by [importModel] on indexes
+     * for other targets instead of parsing and resolving again.
+     */
+    @KsMethod("/export_model")
+    suspend fun exportModel(output: String)
+
+    @KsMethod("/import_model")
+    suspend fun importModel(input: String)
+
+    /**
+     * Report on the last [filterAndResolve], empty when the model was imported instead.
+     */
+    @KsMethod("/resolution_report")
+    suspend fun resolutionReport(u: Unit): ResolutionReport
 }
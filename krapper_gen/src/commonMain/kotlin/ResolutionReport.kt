@@ -0,0 +1,54 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper
+
+import kotlinx.serialization.Serializable
+
+/**
+ * What happened while resolving the filtered classes of an index, for finding out why a class
+ * is missing from the output or where resolution time goes.
+ */
+@Serializable
+data class ResolutionReport(
+    val resolved: List<ResolvedClassReport> = emptyList(),
+    val dropped: List<DroppedReport> = emptyList(),
+    /**
+     * Classes pulled in because something referenced them under
+     * [ReferencePolicy.INCLUDE_MISSING], including template instantiations.
+     */
+    val included: List<String> = emptyList(),
+    val typeMappingCache: CacheReport = CacheReport(0, 0)
+)
+
+/**
+ * [timeUs] is the total over every time the class was resolved, and includes the time spent
+ * resolving any classes it pulled in.
+ */
+@Serializable
+data class ResolvedClassReport(val type: String, val timeUs: Long)
+
+/**
+ * An element or type reference left out of the output, [element] is null when the failure
+ * isn't tied to a declaration.
+ */
+@Serializable
+data class DroppedReport(val element: String?, val type: String?, val reason: String)
+
+@Serializable
+data class CacheReport(val hits: Long, val misses: Long) {
+    val hitRate: Double
+        get() = if (hits + misses == 0L) 0.0 else hits.toDouble() / (hits + misses)
+}
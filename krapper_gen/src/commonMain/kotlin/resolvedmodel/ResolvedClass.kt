@@ -31,7 +31,12 @@ data class ResolvedClassMetadata(
     val hasConstructor: Boolean = false,
     val hasPrivateConstField: Boolean = false,
     val hasDefaultConstructor: Boolean = false,
-    val hasCopyConstructor: Boolean = false
+    val hasCopyConstructor: Boolean = false,
+    /**
+     * POD with only public primitive fields, all of them wrapped. These get a matching C struct
+     * in the header so their fields can be read from memory directly.
+     */
+    val isPlainStruct: Boolean = false
 )
 
 @Serializable
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.resolvedmodel
+
+import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedKotlinType
+import kotlinx.serialization.SerialName
+import kotlinx.serialization.Serializable
+
+/**
+ * A static const or constexpr variable whose value was folded at generation time, emitted as a
+ * Kotlin `const val` so reading it never calls into native code. [scope] is the qualified
+ * namespace or class it is declared in, and [value] is decimal text.
+ */
+@Serializable
+@SerialName("constant")
+data class ResolvedConstant(
+    val name: String,
+    val scope: String,
+    val kotlinType: ResolvedKotlinType,
+    val value: String
+) : ResolvedElement() {
+
+    override fun cloneWithoutChildren(): ResolvedConstant = copy(kotlinType = kotlinType.copy())
+
+    override fun toString(): String = "const $scope::$name: $kotlinType = $value"
+}
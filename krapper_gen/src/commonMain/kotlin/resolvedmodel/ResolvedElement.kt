@@ -62,6 +62,13 @@ abstract class ResolvedElement(
         mutableChildren.remove(child)
     }
 
+    internal fun removeChildAt(index: Int): ResolvedElement = mutableChildren.removeAt(index)
+
+    internal fun replaceChildAt(index: Int, replacement: ResolvedElement): ResolvedElement {
+        replacement.parent = this
+        return mutableChildren.set(index, replacement)
+    }
+
     internal fun setParents() {
         for (child in mutableChildren) {
             child.parent = this
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.resolvedmodel
+
+import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedKotlinType
+import kotlinx.serialization.SerialName
+import kotlinx.serialization.Serializable
+
+/**
+ * A C++ enum, generated as a Kotlin value class over [integerType] with its constants in the
+ * companion. Wrappers take and return the value class and pass its integer across to C.
+ */
+@Serializable
+@SerialName("enum")
+data class ResolvedEnum(
+    val qualified: String,
+    val kotlinType: ResolvedKotlinType,
+    val integerType: ResolvedKotlinType,
+    val constants: List<ResolvedEnumConstant>
+) : ResolvedElement() {
+
+    override fun cloneWithoutChildren(): ResolvedEnum = copy(
+        kotlinType = kotlinType.cloneWithoutChildren(),
+        integerType = integerType.cloneWithoutChildren(),
+        constants = constants.map { it.copy() }
+    )
+
+    override fun toString(): String =
+        "enum $qualified : $integerType { ${constants.joinToString(", ")} }"
+}
+
+/**
+ * [value] is the decimal value, read as unsigned when the underlying type is unsigned.
+ */
+@Serializable
+data class ResolvedEnumConstant(val name: String, val value: String) {
+    override fun toString(): String = "$name = $value"
+}
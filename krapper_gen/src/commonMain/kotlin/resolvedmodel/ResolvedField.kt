@@ -42,7 +42,12 @@ data class ResolvedField(
     val getter: ResolvedFieldGetter,
     val setter: ResolvedFieldSetter,
     val kotlinType: ResolvedKotlinType = (getter.returnType as? ResolvedCppType)?.kotlinType
-        ?: error("No type supplied")
+        ?: error("No type supplied"),
+    /**
+     * Byte offset of a primitive field in a standard layout class, these are read and written
+     * straight from memory rather than through the getter and setter.
+     */
+    val offset: Long? = null
 ) : ResolvedElement() {
 
     override fun cloneWithoutChildren(): ResolvedField =
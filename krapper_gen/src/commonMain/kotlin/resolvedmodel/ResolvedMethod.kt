@@ -213,7 +213,8 @@ enum class ArgumentCastMode {
     STRING,
     REINT_CAST,
     RAW_CAST,
-    STD_MOVE
+    STD_MOVE,
+    VIEW
 }
 
 @Serializable
@@ -29,10 +29,12 @@ val resolvedSerializerModule = SerializersModule {
         subclass(ResolvedClass::class)
         subclass(ResolvedTemplate::class)
         subclass(ResolvedTypedef::class)
+        subclass(ResolvedEnum::class)
         subclass(ResolvedConstructor::class)
         subclass(ResolvedDestructor::class)
         subclass(ResolvedMethod::class)
         subclass(ResolvedField::class)
+        subclass(ResolvedConstant::class)
         subclass(ResolvedCType::class)
         subclass(ResolvedCppType::class)
         subclass(ResolvedKotlinType::class)
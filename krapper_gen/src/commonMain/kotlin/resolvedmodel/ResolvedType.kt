@@ -25,7 +25,12 @@ enum class CastMethod {
     STRING_CAST,
     POINTED_STRING_CAST,
     CAST,
-    NATIVE
+    NATIVE,
+
+    /**
+     * Passed as its underlying integer type, needs an explicit cast on the C++ side.
+     */
+    ENUM
 }
 
 @Serializable
@@ -107,7 +112,11 @@ data class ResolvedKotlinType(
     private val qualifyList: List<String>,
     val isWrapper: Boolean,
     val templates: List<ResolvedKotlinType> = emptyList(),
-    val isNullable: Boolean = false
+    val isNullable: Boolean = false,
+    /**
+     * A value class over an enum's integer, unwrapped with `.value` before passing it to C.
+     */
+    val isEnum: Boolean = false
 ) : ResolvedType(qualifyList.last()),
     FqSymbol {
     private val mappedName: String
@@ -27,7 +27,8 @@ import com.github.ajalt.clikt.parameters.options.flag
 import com.github.ajalt.clikt.parameters.options.multiple
 import com.github.ajalt.clikt.parameters.options.option
 import com.github.ajalt.clikt.parameters.types.enum
-import com.monkopedia.krapper.AddToChild
+import com.monkopedia.krapper.CallInstrumentation
+import com.monkopedia.krapper.DEFAULT_LANGUAGE_STANDARD
 import com.monkopedia.krapper.DefaultFilter
 import com.monkopedia.krapper.ErrorPolicy.FAIL
 import com.monkopedia.krapper.ErrorPolicy.LOG
@@ -35,23 +36,15 @@ import com.monkopedia.krapper.IndexRequest
 import com.monkopedia.krapper.KrapperConfig
 import com.monkopedia.krapper.KrapperService
 import com.monkopedia.krapper.ReplaceChild
-import com.monkopedia.krapper.addMapping
 import com.monkopedia.krapper.addTypedMapping
 import com.monkopedia.krapper.generator.builders.CodeGenerationPolicy
 import com.monkopedia.krapper.generator.builders.LogPolicy
 import com.monkopedia.krapper.generator.builders.ThrowPolicy
 import com.monkopedia.krapper.generator.codegen.File
 import com.monkopedia.krapper.generator.codegen.getcwd
-import com.monkopedia.krapper.generator.model.type.WrappedType
-import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.REINT_CAST
-import com.monkopedia.krapper.generator.resolvedmodel.MethodType.METHOD
-import com.monkopedia.krapper.generator.resolvedmodel.ResolvedArgument
-import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
 import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle.COPY_CONSTRUCTOR
-import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle.VOIDP
 import com.monkopedia.krapper.generator.resolvedmodel.resolvedSerializerModule
-import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedCType
 import com.monkopedia.ksrpc.ErrorListener
 import com.monkopedia.ksrpc.channels.registerDefault
 import com.monkopedia.ksrpc.ksrpcEnvironment
@@ -113,6 +106,20 @@ class KrapperGen : CliktCommand() {
     )
         .enum<ReferencePolicy>()
         .default(ReferencePolicy.IGNORE_MISSING)
+    val trace by option(
+        "--trace",
+        help = "Write a Chrome trace of the generation phases to the given file"
+    )
+    val instrumentation by option(
+        "--instrument",
+        help = "Count (COUNT), also time (TIME) or add USDT probes (PROBES) to every wrapper"
+    )
+        .enum<CallInstrumentation>()
+        .default(CallInstrumentation.NONE)
+    val languageStandard by option(
+        "--std",
+        help = "C++ language standard to parse and compile with"
+    ).default(DEFAULT_LANGUAGE_STANDARD)
     val serviceMode by option(
         "-s",
         help = "Tells Krapper to host a ksrpc service on std in/out, and ignores all other options"
@@ -131,9 +138,12 @@ class KrapperGen : CliktCommand() {
                     moduleName = moduleName ?: File(header.first()).name,
                     errorPolicy = errorPolicy,
                     referencePolicy = referencePolicy,
-                    debug = debug
+                    debug = debug,
+                    instrumentation = instrumentation,
+                    languageStandard = languageStandard
                 )
             )
+            Trace.enabled = trace != null
             val indexService = service.index(IndexRequest(header, library))
             indexService.filterAndResolve(DefaultFilter)
 //            for (file in header) {
@@ -229,71 +239,12 @@ class KrapperGen : CliktCommand() {
                     }
                 }
             )
-//            indexService.addTypedMapping(ResolvedClass)
-            indexService.addMapping(
-                filter = {
-                    (thiz isType ResolvedClass) and
-                        (qualified startsWith "std::unique_ptr") and
-                        (className eq "unique_ptr")
-                },
-                handler = { request ->
-                    val parent = request.child
-                    parent as ResolvedClass
-                    val wrappedType = WrappedType(
-                        parent.type.typeString.replace(
-                            "std::unique_ptr<",
-                            ""
-                        ).removeSuffix(">")
-                    )
-                    listOf(
-                        AddToChild(
-                            ResolvedMethod(
-                                "get",
-                                parent.type.copy(
-                                    typeString = wrappedType.toString(),
-                                    kotlinType = toResolvedKotlinType(
-                                        wrappedType.kotlinType
-                                    ),
-                                    cType = toResolvedCType(wrappedType.cType)
-                                ),
-                                METHOD,
-                                "_custom_unique_ptr_get_${
-                                    parent.type.typeString.replace("<", "_").replace(">", "_")
-                                        .replace("::", "_")
-                                }",
-                                null,
-                                listOf(
-                                    ResolvedArgument(
-                                        "thiz",
-                                        parent.type.copy(
-                                            typeString = parent.type.type + "*",
-                                            cType = ResolvedCType("void*", false)
-                                        ),
-                                        parent.type.copy(
-                                            typeString = parent.type.type + "*",
-                                            cType = ResolvedCType("void*", false)
-                                        ),
-                                        "",
-                                        REINT_CAST,
-                                        needsDereference = true,
-                                        hasDefault = false
-                                    )
-                                ),
-                                VOIDP,
-                                false,
-                                parent.type.typeString
-                            ).also {
-                                Log.i("Adding $it to $parent")
-                            }
-                        )
-                    )
-                }
-            )
 //            debug?.let {
 //                val clsStr = Json.encodeToString(resolver.tu)
 //                File(it).writeText(clsStr)
 //            }
             indexService.writeTo(output ?: getcwd())
+            trace?.let { Trace.writeTo(File(it)) }
         }
     }
 
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.github.ajalt.clikt.core.CliktCommand
+import com.github.ajalt.clikt.core.ProgramResult
+import com.github.ajalt.clikt.parameters.options.default
+import com.github.ajalt.clikt.parameters.options.flag
+import com.github.ajalt.clikt.parameters.options.multiple
+import com.github.ajalt.clikt.parameters.options.option
+import com.github.ajalt.clikt.parameters.types.double
+import com.github.ajalt.clikt.parameters.types.int
+import com.monkopedia.krapper.DefaultFilter
+import com.monkopedia.krapper.IndexRequest
+import com.monkopedia.krapper.KrapperConfig
+import com.monkopedia.krapper.generator.codegen.File
+import kotlinx.coroutines.runBlocking
+import kotlinx.serialization.Serializable
+import kotlinx.serialization.json.Json
+
+/**
+ * Phases of the pipeline reported by [KrapperBench], these are the names of the [Trace] spans
+ * they come from.
+ */
+val BENCH_PHASES = listOf(
+    "includeDiscovery",
+    "parse",
+    "mapAll",
+    "findClasses",
+    "resolveAll",
+    "emitHeader",
+    "emitCpp",
+    "emitDef",
+    "compile",
+    "emitKotlin"
+)
+
+class BenchInput(val name: String, val headers: List<String>, val declarations: Int? = null)
+
+/**
+ * Cost of one phase. The peak RSS from getrusage is a high-water mark for the whole process, so
+ * [rssGrowthKb] is how far the phase raised it rather than the phase's own peak.
+ */
+@Serializable
+data class PhaseResult(val wallMs: Double, val rssGrowthKb: Long, val minorFaults: Long)
+
+@Serializable
+data class SuiteResult(
+    val wallMs: Double,
+    val rssGrowthKb: Long,
+    val phases: Map<String, PhaseResult>,
+    val declarations: Int? = null
+)
+
+@Serializable
+data class BenchReport(val suites: Map<String, SuiteResult>)
+
+/**
+ * Runs the full generation pipeline on fixed inputs without the Gradle plugin and reports the
+ * cost of each phase, optionally failing when it has regressed from a recorded baseline.
+ */
+class KrapperBench : CliktCommand(name = "krapper_bench") {
+    val root by option("--root", help = "Repository root the inputs are found in").default(".")
+    val suites by option("--suite", help = "Suites to run, all of them if none are given")
+        .multiple()
+    val compiler by option("-c", "--compiler", help = "Compiler for the wrapper module")
+        .default("clang++")
+    val iterations by option("--iterations", help = "Runs per suite, the fastest is reported")
+        .int()
+        .default(3)
+    val output by option("-o", "--output", help = "File to write the results to as JSON")
+    val baseline by option(
+        "--baseline",
+        help = "Results to compare against, krapper_gen/benchmark/baseline.json under the root " +
+            "by default"
+    )
+    val updateBaseline by option(
+        "--update-baseline",
+        help = "Write the results to the baseline file instead of comparing"
+    ).flag()
+    val synthetic by option(
+        "--synthetic",
+        help = "Also run a generated header with about this many declarations, see SyntheticHeader"
+    ).int().multiple()
+    val tolerance by option(
+        "--tolerance",
+        help = "Allowed slowdown over the baseline as a fraction"
+    ).double().default(0.25)
+    val workDir by option(
+        "--work-dir",
+        help = "Directory for generated headers and output, krapper_gen/build/benchmark/work " +
+            "under the root by default"
+    )
+
+    private val workRoot: File
+        get() = File(workDir ?: "$root/krapper_gen/build/benchmark/work")
+
+    private val json = Json {
+        prettyPrint = true
+    }
+
+    fun inputs(): List<BenchInput> = listOf(
+        BenchInput("testlib", listOf("$root/testlib/testlib.hh")),
+        BenchInput(
+            "v8",
+            listOf("$root/example/include/v8-isolate.h", "$root/example/include/v8-template.h")
+        )
+    ) + synthetic.map { count ->
+        val header = SyntheticHeader.withDeclarations(count)
+        val file = File(workRoot, "synthetic_$count.hh")
+        file.parent.mkdirs()
+        file.writeText(header.generate())
+        BenchInput("synthetic-$count", listOf(file.path), header.declarationCount)
+    }
+
+    override fun run() {
+        Log.level = LogLevel.WARN
+        val selected = inputs().filter {
+            suites.isEmpty() || it.name in suites || it.declarations != null
+        }
+        val report = BenchReport(
+            selected.associate { input ->
+                input.name to (1..iterations).map { runSuite(input) }.reduce(::fastest)
+                    .copy(declarations = input.declarations)
+            }
+        )
+        val text = json.encodeToString(BenchReport.serializer(), report)
+        output?.let { File(it).writeText(text) } ?: println(text)
+        printScaling(report)
+
+        val baselineFile = File(baseline ?: "$root/krapper_gen/benchmark/baseline.json")
+        if (updateBaseline) {
+            baselineFile.writeText(text)
+            return
+        }
+        if (!baselineFile.exists()) {
+            println("No baseline at ${baselineFile.path}, run with --update-baseline to record one")
+            throw ProgramResult(1)
+        }
+        val regressions = compare(
+            json.decodeFromString(BenchReport.serializer(), baselineFile.readText()),
+            report
+        )
+        regressions.forEach(::println)
+        if (regressions.isNotEmpty()) {
+            throw ProgramResult(1)
+        }
+    }
+
+    private fun runSuite(input: BenchInput): SuiteResult = runBlocking {
+        val outDir = File(workRoot, input.name)
+        val service = KrapperServiceImpl()
+        service.setConfig(
+            KrapperConfig(
+                pkg = "krapper.bench",
+                compiler = compiler,
+                moduleName = input.name,
+                errorPolicy = ErrorPolicy.LOG,
+                referencePolicy = ReferencePolicy.INCLUDE_MISSING,
+                debug = false
+            )
+        )
+        ParseCache.clear()
+        Trace.drain()
+        Trace.enabled = true
+        val startUs = Trace.now()
+        val startRssKb = Trace.peakRssKb()
+        val index = service.index(IndexRequest(input.headers.map { File(it).path }, emptyList()))
+        index.filterAndResolve(DefaultFilter)
+        index.writeTo(outDir.path)
+        index.close()
+        val wallMs = (Trace.now() - startUs) / 1000.0
+        Trace.enabled = false
+        val events = Trace.drain()
+        SuiteResult(
+            wallMs,
+            Trace.peakRssKb() - startRssKb,
+            BENCH_PHASES.mapNotNull { phase ->
+                val phaseEvents = events.filter { it.name == phase }
+                if (phaseEvents.isEmpty()) return@mapNotNull null
+                phase to PhaseResult(
+                    phaseEvents.sumOf { it.durationUs } / 1000.0,
+                    phaseEvents.sumOf { it.rssGrowthKb },
+                    phaseEvents.sumOf { it.minorFaults }
+                )
+            }.toMap()
+        )
+    }
+
+    /**
+     * Prints the cost per thousand declarations of each phase across the synthetic sizes, and
+     * calls out phases where that cost grows with size.
+     */
+    private fun printScaling(report: BenchReport) {
+        val sized = report.suites.values.filter { it.declarations != null }
+            .sortedBy { it.declarations }
+        if (sized.size < 2) return
+        println("Per 1k declarations (ms): " + sized.joinToString(" ") { "${it.declarations}" })
+        for (phase in BENCH_PHASES) {
+            val costs = sized.map { suite ->
+                (suite.phases[phase]?.wallMs ?: 0.0) * 1000 / suite.declarations!!
+            }
+            val growth = costs.last() / costs.first().coerceAtLeast(0.001)
+            val note = if (growth > SUPERLINEAR_GROWTH) "  <- super-linear" else ""
+            println("$phase: " + costs.joinToString(" ") { it.toString().take(8) } + note)
+        }
+    }
+
+    private fun fastest(first: SuiteResult, second: SuiteResult): SuiteResult = SuiteResult(
+        minOf(first.wallMs, second.wallMs),
+        maxOf(first.rssGrowthKb, second.rssGrowthKb),
+        (first.phases.keys + second.phases.keys).associateWith { phase ->
+            val a = first.phases[phase]
+            val b = second.phases[phase]
+            if (a == null || b == null) return@associateWith a ?: b!!
+            PhaseResult(
+                minOf(a.wallMs, b.wallMs),
+                maxOf(a.rssGrowthKb, b.rssGrowthKb),
+                minOf(a.minorFaults, b.minorFaults)
+            )
+        }
+    )
+
+    private fun compare(baseline: BenchReport, current: BenchReport): List<String> =
+        buildList {
+            // Synthetic suites change with the requested sizes, so only fixed ones get a warning.
+            for ((suite, actual) in current.suites) {
+                if (actual.declarations == null && suite !in baseline.suites) {
+                    println(
+                        "Warning: $suite has no baseline and wasn't compared, run with " +
+                            "--update-baseline to record one"
+                    )
+                }
+            }
+            for ((suite, expected) in baseline.suites) {
+                val actual = current.suites[suite] ?: continue
+                checkTime("$suite total", expected.wallMs, actual.wallMs)?.let(::add)
+                if (actual.rssGrowthKb > expected.rssGrowthKb * (1 + tolerance)) {
+                    add(
+                        "$suite RSS growth regressed: ${expected.rssGrowthKb}kB -> " +
+                            "${actual.rssGrowthKb}kB"
+                    )
+                }
+                for ((phase, expectedPhase) in expected.phases) {
+                    val actualPhase = actual.phases[phase] ?: continue
+                    checkTime("$suite $phase", expectedPhase.wallMs, actualPhase.wallMs)
+                        ?.let(::add)
+                }
+            }
+        }
+
+    // Phases this short are dominated by noise, so they never count as regressions.
+    private fun checkTime(name: String, expected: Double, actual: Double): String? =
+        if (actual > expected * (1 + tolerance) && actual - expected > MIN_REGRESSION_MS) {
+            "$name regressed: ${expected}ms -> ${actual}ms"
+        } else {
+            null
+        }
+
+    companion object {
+        private const val MIN_REGRESSION_MS = 20.0
+
+        // Per declaration cost growing by more than this from the smallest to the largest
+        // synthetic header is reported as super-linear.
+        private const val SUPERLINEAR_GROWTH = 2.0
+    }
+}
@@ -20,6 +20,7 @@ import clang.CXClientData
 import clang.CXCursor
 import clang.CXCursorKind
 import clang.CXCursorVisitor
+import clang.CXEvalResultKind
 import clang.CXFile
 import clang.CXIndex
 import clang.CXRefQualifierKind
@@ -44,6 +45,7 @@ import clang.clang_CXXMethod_isPureVirtual
 import clang.clang_CXXMethod_isStatic
 import clang.clang_CXXMethod_isVirtual
 import clang.clang_CXXRecord_isAbstract
+import clang.clang_Cursor_Evaluate
 import clang.clang_Cursor_getArgument
 import clang.clang_Cursor_getBriefCommentText
 import clang.clang_Cursor_getMangling
@@ -58,6 +60,12 @@ import clang.clang_Cursor_getTemplateArgumentValue
 import clang.clang_Cursor_isAnonymous
 import clang.clang_Cursor_isBitField
 import clang.clang_EnumDecl_isScoped
+import clang.clang_EvalResult_dispose
+import clang.clang_EvalResult_getAsDouble
+import clang.clang_EvalResult_getAsLongLong
+import clang.clang_EvalResult_getAsUnsigned
+import clang.clang_EvalResult_getKind
+import clang.clang_EvalResult_isUnsignedInt
 import clang.clang_File_tryGetRealPathName
 import clang.clang_IndexAction_create
 import clang.clang_Type_getAlignOf
@@ -494,6 +502,28 @@ inline val CValue<CXCursor>.rawCommentText: CValue<CXString>
     get() = clang_Cursor_getRawCommentText(this)
 inline val CValue<CXCursor>.offsetOfField: Long
     get() = clang_Cursor_getOffsetOfField(this)
+
+/**
+ * The value clang folds this declaration's initializer to, as decimal text, or null when it
+ * isn't an integral or floating point constant.
+ */
+fun CValue<CXCursor>.evaluateNumber(): String? {
+    val result = clang_Cursor_Evaluate(this) ?: return null
+    try {
+        return when (clang_EvalResult_getKind(result)) {
+            CXEvalResultKind.CXEval_Int ->
+                if (clang_EvalResult_isUnsignedInt(result) != 0U) {
+                    clang_EvalResult_getAsUnsigned(result).toString()
+                } else {
+                    clang_EvalResult_getAsLongLong(result).toString()
+                }
+            CXEvalResultKind.CXEval_Float -> clang_EvalResult_getAsDouble(result).toString()
+            else -> null
+        }
+    } finally {
+        clang_EvalResult_dispose(result)
+    }
+}
 inline val CValue<CXType>.align: Long
     get() = clang_Type_getAlignOf(this)
 inline val CValue<CXType>.classType: CValue<CXType>
@@ -0,0 +1,504 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.AndFilter
+import com.monkopedia.krapper.DefaultFilter
+import com.monkopedia.krapper.FilterDefinition
+import com.monkopedia.krapper.FilterableTypes
+import com.monkopedia.krapper.FilterableTypes.CLASS
+import com.monkopedia.krapper.FilterableTypes.FIELD
+import com.monkopedia.krapper.FilterableTypes.METHOD
+import com.monkopedia.krapper.FilterableTypes.TYPE
+import com.monkopedia.krapper.HierarchyFilter
+import com.monkopedia.krapper.HierarchyTarget
+import com.monkopedia.krapper.HierarchyTarget.ALL_CHILDREN
+import com.monkopedia.krapper.HierarchyTarget.ANY_CHILD
+import com.monkopedia.krapper.HierarchyTarget.BASE
+import com.monkopedia.krapper.HierarchyTarget.PARENT
+import com.monkopedia.krapper.NotFilter
+import com.monkopedia.krapper.OrFilter
+import com.monkopedia.krapper.StringFilter
+import com.monkopedia.krapper.StringMatcher
+import com.monkopedia.krapper.StringMatcherType.CONTAINS
+import com.monkopedia.krapper.StringMatcherType.ENDS_WITH
+import com.monkopedia.krapper.StringMatcherType.EQUALS
+import com.monkopedia.krapper.StringMatcherType.REGEX
+import com.monkopedia.krapper.StringMatcherType.STARTS_WITH
+import com.monkopedia.krapper.StringSelector
+import com.monkopedia.krapper.StringSelector.CLASS_NAME
+import com.monkopedia.krapper.StringSelector.CLASS_QUALIFIED
+import com.monkopedia.krapper.StringSelector.METHOD_NAME
+import com.monkopedia.krapper.StringSelector.METHOD_RETURN_TYPE
+import com.monkopedia.krapper.StringSelector.METHOD_TYPE
+import com.monkopedia.krapper.StringSelector.NAMESPACE
+import com.monkopedia.krapper.StringSelector.STRINGIFY
+import com.monkopedia.krapper.TypeFilter
+import com.monkopedia.krapper.generator.model.WrappedClass
+import com.monkopedia.krapper.generator.model.WrappedElement
+import com.monkopedia.krapper.generator.model.WrappedField
+import com.monkopedia.krapper.generator.model.WrappedMethod
+import com.monkopedia.krapper.generator.model.WrappedNamespace
+import com.monkopedia.krapper.generator.model.baseParent
+import com.monkopedia.krapper.generator.model.type.WrappedType
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedNamespace
+import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedType
+import kotlin.experimental.ExperimentalNativeApi
+import kotlin.native.identityHashCode
+
+/**
+ * How a [FilterPlan] walks and inspects a particular element model, so the same compiled
+ * plan logic can run against both the parsed (wrapped) and resolved trees.
+ */
+interface FilterModel<T : Any> {
+    fun parent(element: T): T?
+    fun baseParent(element: T): T
+    fun children(element: T): List<T>
+    fun isType(element: T, type: FilterableTypes): Boolean
+    fun select(element: T, selector: StringSelector): String?
+}
+
+object WrappedFilterModel : FilterModel<WrappedElement> {
+    override fun parent(element: WrappedElement): WrappedElement? = element.parent
+    override fun baseParent(element: WrappedElement): WrappedElement = element.baseParent
+    override fun children(element: WrappedElement): List<WrappedElement> = element.children
+
+    override fun isType(element: WrappedElement, type: FilterableTypes): Boolean = when (type) {
+        CLASS -> element is WrappedClass
+        METHOD -> element is WrappedMethod
+        FIELD -> element is WrappedField
+        TYPE -> element is WrappedType
+        FilterableTypes.NAMESPACE -> element is WrappedNamespace
+    }
+
+    override fun select(element: WrappedElement, selector: StringSelector): String? =
+        when (selector) {
+            STRINGIFY -> element.toString()
+            CLASS_NAME -> (element as? WrappedClass)?.name
+            CLASS_QUALIFIED -> (element as? WrappedClass)?.type?.toString()
+            METHOD_NAME -> (element as? WrappedMethod)?.name
+            METHOD_TYPE -> (element as? WrappedMethod)?.methodType?.toString()
+            METHOD_RETURN_TYPE -> (element as? WrappedMethod)?.returnType?.toString()
+            NAMESPACE -> (element as? WrappedNamespace)?.namespace
+        }
+}
+
+object ResolvedFilterModel : FilterModel<ResolvedElement> {
+    override fun parent(element: ResolvedElement): ResolvedElement? = element.parent
+    override fun baseParent(element: ResolvedElement): ResolvedElement = element.baseParent
+    override fun children(element: ResolvedElement): List<ResolvedElement> = element.children
+
+    override fun isType(element: ResolvedElement, type: FilterableTypes): Boolean = when (type) {
+        CLASS -> element is ResolvedClass
+        METHOD -> element is ResolvedMethod
+        FIELD -> element is ResolvedField
+        TYPE -> element is ResolvedType
+        FilterableTypes.NAMESPACE -> element is ResolvedNamespace
+    }
+
+    override fun select(element: ResolvedElement, selector: StringSelector): String? =
+        when (selector) {
+            STRINGIFY -> element.toString()
+            CLASS_NAME -> (element as? ResolvedClass)?.name
+            CLASS_QUALIFIED -> (element as? ResolvedClass)?.type?.type
+            METHOD_NAME -> (element as? ResolvedMethod)?.name
+            METHOD_TYPE -> (element as? ResolvedMethod)?.methodType?.toString()
+            METHOD_RETURN_TYPE -> (element as? ResolvedMethod)?.returnType?.type
+            NAMESPACE -> (element as? ResolvedNamespace)?.namespace
+        }
+}
+
+/**
+ * Snapshot of a model that [FilterPlan]s can be bound to. It records traversal order and
+ * lazily builds a prefix trie per indexed selector, so [STARTS_WITH]/[EQUALS] checks on
+ * qualified names and namespaces become lookups instead of a scan over every element. After
+ * a mutation, [update] refiles only the elements it touched.
+ */
+class FilterIndex<T : Any>(private val model: FilterModel<T>, elements: Sequence<T>) {
+    val elements: List<T> = elements.toList()
+    private val order = IdentityMap<T, Int>().also { order ->
+        this.elements.forEachIndexed { index, element ->
+            order[element] = index
+        }
+    }
+    private val tries = mutableMapOf<StringSelector, PrefixTrie<T>>()
+
+    // The value each element is filed under in the trie of the same selector.
+    private val filed = mutableMapOf<StringSelector, IdentityMap<T, String>>()
+
+    operator fun contains(element: T): Boolean = order.containsKey(element)
+
+    /**
+     * Drops the tries so the next lookup sees selector values changed since they were built.
+     */
+    fun invalidate() {
+        tries.clear()
+        filed.clear()
+    }
+
+    /**
+     * Refiles [touched], along with their ancestors and descendants, under their current
+     * selector values and returns all of them, for passing on to [FilterPlan.invalidate]. This
+     * costs the size of the affected subtrees rather than a rebuild over every element.
+     */
+    fun update(touched: Collection<T>): List<T> {
+        val seen = IdentityMap<T, Unit>()
+        val affected = mutableListOf<T>()
+        for (element in touched) {
+            var parent = model.parent(element)
+            while (parent != null && seen.put(parent, Unit)) {
+                affected.add(parent)
+                parent = model.parent(parent)
+            }
+            val pending = ArrayDeque(listOf(element))
+            while (pending.isNotEmpty()) {
+                val next = pending.removeLast()
+                if (seen.put(next, Unit)) {
+                    affected.add(next)
+                } else if (next !== element) {
+                    continue
+                }
+                pending.addAll(model.children(next))
+            }
+        }
+        for ((selector, trie) in tries) {
+            val values = filed.getValue(selector)
+            for (element in affected) {
+                if (element !in this) continue
+                values.remove(element)?.let { trie.remove(it, element) }
+                model.select(element, selector)?.let {
+                    trie.add(it, element)
+                    values[element] = it
+                }
+            }
+        }
+        return affected
+    }
+
+    fun orderOf(element: T): Int = order[element] ?: Int.MAX_VALUE
+
+    fun lookup(selector: StringSelector, matcher: StringMatcher): List<T> {
+        val trie = tries.getOrPut(selector) {
+            val values = IdentityMap<T, String>().also { filed[selector] = it }
+            PrefixTrie<T>().also { trie ->
+                for (element in elements) {
+                    model.select(element, selector)?.let {
+                        trie.add(it, element)
+                        values[element] = it
+                    }
+                }
+            }
+        }
+        return when (matcher.type) {
+            STARTS_WITH -> trie.withPrefix(matcher.str).sortedBy(::orderOf)
+            EQUALS -> trie.exactly(matcher.str)
+            else -> error("${matcher.type} can't be answered by the index")
+        }
+    }
+
+    companion object {
+        val INDEXED_SELECTORS = setOf(CLASS_QUALIFIED, NAMESPACE)
+    }
+}
+
+/**
+ * A [FilterDefinition] compiled once into a tree of evaluation nodes. Regexes are built at
+ * compile time, selector strings and hierarchy results are memoized per element, and when
+ * [bind] is given a [FilterIndex] indexable string checks are answered from it.
+ *
+ * Memoized results assume the model isn't changing underneath the plan. Callers that mutate
+ * the tree between evaluations should pass what they touched through [FilterIndex.update] and
+ * the result to [invalidate], or call the no argument [invalidate] to start over entirely,
+ * which also rebuilds the bound index.
+ */
+class FilterPlan<T : Any>(
+    definition: FilterDefinition,
+    private val model: FilterModel<T>
+) : (T) -> Boolean {
+    private val selections = mutableMapOf<StringSelector, IdentityMap<T, String?>>()
+    private val memos = mutableListOf<IdentityMap<T, Boolean>>()
+    private val indexedNodes = mutableListOf<IndexedStringNode>()
+    private var index: FilterIndex<T>? = null
+    private val root: Node = compile(definition)
+
+    fun bind(index: FilterIndex<T>): FilterPlan<T> = apply {
+        this.index = index
+        indexedNodes.forEach { it.reset() }
+    }
+
+    fun invalidate() {
+        selections.clear()
+        memos.forEach { it.clear() }
+        index?.invalidate()
+        indexedNodes.forEach { it.reset() }
+    }
+
+    /**
+     * Forgets what was memoized for [affected] only, as returned by [FilterIndex.update].
+     */
+    fun invalidate(affected: Collection<T>) {
+        for (element in affected) {
+            selections.values.forEach { it.remove(element) }
+            memos.forEach { it.remove(element) }
+        }
+        indexedNodes.forEach { it.refresh(affected) }
+    }
+
+    override fun invoke(element: T): Boolean = root.matches(element)
+
+    /**
+     * Elements of the bound index that could possibly match, in traversal order, or null when
+     * the plan can't narrow things down and every element needs to be checked.
+     */
+    fun candidates(): List<T>? = root.candidates()
+
+    private fun select(element: T, selector: StringSelector): String? {
+        val cache = selections.getOrPut(selector) { IdentityMap() }
+        return cache.getOrPut(element) { model.select(element, selector) }
+    }
+
+    private fun compile(definition: FilterDefinition): Node = when (definition) {
+        is AndFilter -> AndNode(definition.elements.map(::compile))
+        is OrFilter -> OrNode(definition.elements.map(::compile))
+        is NotFilter -> NotNode(compile(definition.base))
+        DefaultFilter -> compile(defaultFilter())
+        is HierarchyFilter -> HierarchyNode(definition.target, compile(definition.filter))
+        is StringFilter -> {
+            if (definition.selector in FilterIndex.INDEXED_SELECTORS &&
+                (definition.matcher.type == STARTS_WITH || definition.matcher.type == EQUALS)
+            ) {
+                IndexedStringNode(definition.selector, definition.matcher)
+                    .also(indexedNodes::add)
+            } else {
+                StringNode(definition.selector, definition.matcher.compile())
+            }
+        }
+        is TypeFilter -> TypeNode(definition.types.toSet())
+    }
+
+    private abstract inner class Node {
+        abstract fun matches(element: T): Boolean
+        open fun candidates(): List<T>? = null
+    }
+
+    private inner class AndNode(private val each: List<Node>) : Node() {
+        override fun matches(element: T): Boolean = each.all { it.matches(element) }
+
+        override fun candidates(): List<T>? =
+            each.mapNotNull { it.candidates() }.minByOrNull { it.size }
+    }
+
+    private inner class OrNode(private val each: List<Node>) : Node() {
+        override fun matches(element: T): Boolean = each.any { it.matches(element) }
+
+        override fun candidates(): List<T>? {
+            val index = index ?: return null
+            val all = each.map { it.candidates() ?: return null }
+            val seen = IdentityMap<T, Unit>()
+            return all.flatten().filter { seen.put(it, Unit) }.sortedBy(index::orderOf)
+        }
+    }
+
+    private inner class NotNode(private val base: Node) : Node() {
+        override fun matches(element: T): Boolean = !base.matches(element)
+    }
+
+    private inner class TypeNode(private val types: Set<FilterableTypes>) : Node() {
+        override fun matches(element: T): Boolean = types.any { model.isType(element, it) }
+    }
+
+    private inner class HierarchyNode(
+        private val target: HierarchyTarget,
+        private val base: Node
+    ) : Node() {
+        private val memo = IdentityMap<T, Boolean>().also(memos::add)
+
+        override fun matches(element: T): Boolean = when (target) {
+            PARENT -> model.parent(element)?.let(::baseMatches) ?: false
+            BASE -> baseMatches(model.baseParent(element))
+            ANY_CHILD -> memo.getOrPut(element) { model.children(element).any(base::matches) }
+            ALL_CHILDREN -> memo.getOrPut(element) { model.children(element).all(base::matches) }
+        }
+
+        private fun baseMatches(element: T): Boolean = memo.getOrPut(element) {
+            base.matches(element)
+        }
+    }
+
+    private inner class StringNode(
+        private val selector: StringSelector,
+        private val matcher: (String) -> Boolean
+    ) : Node() {
+        override fun matches(element: T): Boolean =
+            select(element, selector)?.let(matcher) ?: false
+    }
+
+    private inner class IndexedStringNode(
+        private val selector: StringSelector,
+        private val matcher: StringMatcher
+    ) : Node() {
+        private val direct = matcher.compile()
+        private var matched: IdentityMap<T, Unit>? = null
+        private var matchedList: List<T>? = null
+
+        fun reset() {
+            matched = null
+            matchedList = null
+        }
+
+        fun refresh(affected: Collection<T>) {
+            val index = index ?: return
+            val set = matched ?: return
+            for (element in affected) {
+                if (element !in index) continue
+                if (select(element, selector)?.let(direct) == true) {
+                    set[element] = Unit
+                } else {
+                    set.remove(element)
+                }
+            }
+            matchedList = null
+        }
+
+        override fun matches(element: T): Boolean {
+            val index = index
+            if (index == null || element !in index) {
+                // Elements added after indexing fall back to checking the string directly.
+                return select(element, selector)?.let(direct) ?: false
+            }
+            return matchedSet(index).containsKey(element)
+        }
+
+        override fun candidates(): List<T>? {
+            val index = index ?: return null
+            matchedSet(index)
+            return matchedList ?: index.lookup(selector, matcher).also { matchedList = it }
+        }
+
+        private fun matchedSet(index: FilterIndex<T>): IdentityMap<T, Unit> =
+            matched ?: IdentityMap<T, Unit>().also { set ->
+                val list = index.lookup(selector, matcher)
+                list.forEach { set[it] = Unit }
+                matched = set
+                matchedList = list
+            }
+    }
+}
+
+private fun StringMatcher.compile(): (String) -> Boolean {
+    val str = this.str
+    return when (this.type) {
+        STARTS_WITH -> { target -> target.startsWith(str) }
+        CONTAINS -> { target -> target.contains(str) }
+        EQUALS -> { target -> target == str }
+        ENDS_WITH -> { target -> target.endsWith(str) }
+        REGEX -> {
+            val regex = Regex(str)
+            return { target -> regex.matches(target) }
+        }
+    }
+}
+
+private class PrefixTrie<T : Any> {
+    private class TrieNode<T> {
+        val next = mutableMapOf<Char, TrieNode<T>>()
+        val values = mutableListOf<T>()
+    }
+
+    private val root = TrieNode<T>()
+
+    fun add(key: String, value: T) {
+        var node = root
+        for (c in key) {
+            node = node.next.getOrPut(c) { TrieNode() }
+        }
+        node.values.add(value)
+    }
+
+    fun remove(key: String, value: T) {
+        find(key)?.values?.removeAll { it === value }
+    }
+
+    fun exactly(key: String): List<T> = find(key)?.values?.toList() ?: emptyList()
+
+    fun withPrefix(prefix: String): List<T> {
+        val start = find(prefix) ?: return emptyList()
+        val ret = mutableListOf<T>()
+        val pending = ArrayDeque(listOf(start))
+        while (pending.isNotEmpty()) {
+            val node = pending.removeLast()
+            ret.addAll(node.values)
+            pending.addAll(node.next.values)
+        }
+        return ret
+    }
+
+    private fun find(key: String): TrieNode<T>? {
+        var node = root
+        for (c in key) {
+            node = node.next[c] ?: return null
+        }
+        return node
+    }
+}
+
+/**
+ * Map keyed on object identity rather than equality, the models are full of data classes
+ * whose equality ignores children and parents.
+ */
+class IdentityMap<K : Any, V> {
+    private val map = HashMap<Identity, V>()
+
+    operator fun get(key: K): V? = map[Identity(key)]
+
+    operator fun set(key: K, value: V) {
+        map[Identity(key)] = value
+    }
+
+    /**
+     * Returns true if [key] was not already present.
+     */
+    fun put(key: K, value: V): Boolean {
+        val identity = Identity(key)
+        val present = map.containsKey(identity)
+        map[identity] = value
+        return !present
+    }
+
+    fun containsKey(key: K): Boolean = map.containsKey(Identity(key))
+
+    fun remove(key: K): V? = map.remove(Identity(key))
+
+    fun clear() = map.clear()
+
+    inline fun getOrPut(key: K, default: () -> V): V {
+        if (containsKey(key)) {
+            @Suppress("UNCHECKED_CAST")
+            return get(key) as V
+        }
+        return default().also { set(key, it) }
+    }
+
+    @OptIn(ExperimentalNativeApi::class)
+    private class Identity(val value: Any) {
+        override fun equals(other: Any?): Boolean = (other as? Identity)?.value === value
+        override fun hashCode(): Int = value.identityHashCode()
+    }
+}
@@ -29,6 +29,7 @@ import com.monkopedia.krapper.RemoveChild
 import com.monkopedia.krapper.RemoveParent
 import com.monkopedia.krapper.ReplaceChild
 import com.monkopedia.krapper.ReplaceParent
+import com.monkopedia.krapper.ResolutionReport
 import com.monkopedia.krapper.ResolverService
 import com.monkopedia.krapper.generator.builders.CppCodeBuilder
 import com.monkopedia.krapper.generator.codegen.CppCompiler
@@ -43,11 +44,22 @@ import com.monkopedia.krapper.generator.model.type.WrappedType
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
 import com.monkopedia.krapper.generator.resolvedmodel.recursiveSequence
+import com.monkopedia.krapper.generator.resolvedmodel.resolvedSerializerModule
 import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedCType
 import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedKotlinType
 import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedType
 import kotlinx.cinterop.Arena
-import kotlinx.coroutines.runBlocking
+import kotlinx.serialization.PolymorphicSerializer
+import kotlinx.serialization.builtins.ListSerializer
+import kotlinx.serialization.json.Json
+
+private val modelJson = Json {
+    serializersModule = resolvedSerializerModule
+}
+private val modelSerializer = ListSerializer(PolymorphicSerializer(ResolvedElement::class))
+private val reportJson = Json {
+    prettyPrint = true
+}
 
 class IndexedServiceImpl(private val config: KrapperConfig, private val request: IndexRequest) :
     IndexedService {
@@ -55,6 +67,7 @@ class IndexedServiceImpl(private val config: KrapperConfig, private val request:
     private val index = createIndex(0, 0) ?: error("Failed to create Index")
     private var classes: List<ResolvedElement> = emptyList()
     private val mappings = mutableListOf<MappingService>()
+    private var report = ResolutionReport()
 
     init {
         scope.defer {
@@ -62,105 +75,160 @@ class IndexedServiceImpl(private val config: KrapperConfig, private val request:
         }
     }
 
-    private val includePaths = generateIncludes(config.compiler)
-    private val args: Array<String> = arrayOf("-xc++", "--std=c++14") +
-        includePaths.map { "-I$it" }.toTypedArray()
-
-    init {
-        if (config.debug) {
-            runBlocking {
-                Log.i("Args: ${args.toList()}")
-            }
-        }
-    }
+    // Only needed for parsing, an index loading a shared model never runs the compiler.
+    private val includePaths by lazy { ParseCache.includePaths(config.compiler) }
 
     override suspend fun filterAndResolve(filter: FilterDefinition) {
         Log.i("Parsing headers: ${request.headers}")
-        val resolver = scope.parseHeader(
-            index,
+        Log.d {
+            "Args: ${parseArgs(includePaths, config.languageStandard).toList()}"
+        }
+        val resolver = ParseCache.resolver(
             request.headers,
             includePaths + request.headerDirectories,
-            debug = config.debug
-        )
+            request.headerDirectories,
+            config.languageStandard
+        ) {
+            scope.parseHeader(
+                index,
+                request.headers,
+                includePaths + request.headerDirectories,
+                languageStandard = config.languageStandard,
+                debug = config.debug
+            )
+        }
         val initialClasses = resolver.findClasses(filter.wrapperFilter())
         Log.i("Found ${initialClasses.size} classes to resolve")
-        if (config.debug) {
+        Log.d {
             val resolvingStr = initialClasses
                 .map { (it as? WrappedClass)?.type?.toString() ?: it.toString() }
                 .sorted()
                 .joinToString(",\n    ")
-            Log.i("Resolving: [\n    $resolvingStr\n]")
+            "Resolving: [\n    $resolvingStr\n]"
+        }
+        val stats = ResolutionStats()
+        classes = Trace.span("resolveAll") {
+            initialClasses.resolveAll(resolver, config.referencePolicy, stats)
         }
-        classes = initialClasses.resolveAll(resolver, config.referencePolicy)
-        Log.i("Resolved ${classes.size} top-level elements")
+        report = stats.toReport(
+            classes.filterIsInstance<ResolvedClass>().map { it.type.toString() }
+        )
+        Log.i(
+            "Resolved ${classes.size} top-level elements, dropped ${report.dropped.size} " +
+                "references, type mapping cache hit rate ${report.typeMappingCache.hitRate}"
+        )
+        Log.flush()
     }
 
+    override suspend fun exportModel(output: String) {
+        File(output).writeText(modelJson.encodeToString(modelSerializer, classes))
+        Log.i("Exported ${classes.size} top-level elements to $output")
+        if (config.trace) {
+            Trace.writeTo(File("$output.trace.json"))
+        }
+        Log.flush()
+    }
+
+    override suspend fun importModel(input: String) {
+        classes = modelJson.decodeFromString(modelSerializer, File(input).readText())
+        classes.forEach { it.setParents() }
+        report = ResolutionReport()
+        Log.i("Imported ${classes.size} top-level elements from $input")
+        Log.flush()
+    }
+
+    override suspend fun resolutionReport(u: Unit): ResolutionReport = report
+
     override suspend fun addMapping(mappingService: MappingService) {
         mappings.add(mappingService)
     }
 
     override suspend fun writeTo(output: String) {
-        if (config.debug) {
-            Log.i("Running mapping")
-        }
+        Log.d("Running mapping")
         if (mappings.isNotEmpty()) {
-            executeMappings()
+            Trace.span("mappings") {
+                executeMappings()
+            }
         }
-        if (config.debug) {
+        Log.d {
             val resolvedClasses = classes
                 .map { (it as? ResolvedClass)?.type?.toString() ?: it.toString() }
                 .sorted()
                 .joinToString(",\n    ")
-            Log.i("Generating for [\n    $resolvedClasses\n]")
+            "Generating for [\n    $resolvedClasses\n]"
         }
         val outputBase = File(output)
         outputBase.mkdirs()
         val namer = NameHandler()
         Log.i("Generating header file")
-        File(outputBase, "${config.moduleName}.h").writeText(
-            CppCodeBuilder().also {
-                HeaderWriter(
-                    it,
-                    policy = config.errorPolicy.policy
-                ).generate(config.moduleName!!, request.headers, classes)
-            }.toString()
-        )
+        Trace.span("emitHeader") {
+            File(outputBase, "${config.moduleName}.h").writeText(
+                CppCodeBuilder().also {
+                    HeaderWriter(
+                        it,
+                        policy = config.errorPolicy.policy,
+                        instrumentation = config.instrumentation
+                    ).generate(config.moduleName!!, request.headers, classes)
+                }.toString()
+            )
+        }
         Log.i("Generating C++ wrapper")
         val cppFile = File(outputBase, "${config.moduleName}.cc")
-        cppFile.writeText(
-            CppCodeBuilder().also {
-                CppWriter(cppFile, it, policy = config.errorPolicy.policy).generate(
+        Trace.span("emitCpp") {
+            cppFile.writeText(
+                CppCodeBuilder().also {
+                    CppWriter(
+                        cppFile,
+                        it,
+                        policy = config.errorPolicy.policy,
+                        instrumentation = config.instrumentation
+                    ).generate(config.moduleName!!, request.headers, classes)
+                }.toString()
+            )
+        }
+        val pkg = config.pkg
+        Trace.span("emitDef") {
+            File(outputBase, "${config.moduleName}.def").writeText(
+                DefWriter(namer).generateDef(
+                    outputBase,
+                    "$pkg.internal",
                     config.moduleName!!,
                     request.headers,
-                    classes
+                    request.libraries
                 )
-            }.toString()
-        )
-        val pkg = config.pkg
-        File(outputBase, "${config.moduleName}.def").writeText(
-            DefWriter(namer).generateDef(
-                outputBase,
-                "$pkg.internal",
-                config.moduleName!!,
+            )
+        }
+        Log.i("Compiling native wrapper library")
+        Trace.span("compile", cppFile.path) {
+            CppCompiler(
+                File(outputBase, "lib${config.moduleName}.a"),
+                config.compiler,
+                config.languageStandard
+            ).compile(
+                cppFile,
                 request.headers,
                 request.libraries
             )
-        )
-        Log.i("Compiling native wrapper library")
-        CppCompiler(File(outputBase, "lib${config.moduleName}.a"), config.compiler).compile(
-            cppFile,
-            request.headers,
-            request.libraries
-        )
+        }
         Log.i("Generating Kotlin bindings")
-        KotlinWriter(
-            "$pkg.internal",
-            policy = config.errorPolicy.policy
-        ).generate(
-            File(outputBase, "src"),
-            classes
+        Trace.span("emitKotlin") {
+            KotlinWriter(
+                "$pkg.internal",
+                policy = config.errorPolicy.policy,
+                callStatsModule = config.moduleName.takeIf { config.instrumentation.hasStats }
+            ).generate(
+                File(outputBase, "src"),
+                classes
+            )
+        }
+        File(outputBase, "${config.moduleName}.resolution.json").writeText(
+            reportJson.encodeToString(ResolutionReport.serializer(), report)
         )
         Log.i("Code generation complete")
+        if (config.trace) {
+            Trace.writeTo(File(outputBase, "${config.moduleName}.trace.json"))
+        }
+        Log.flush()
     }
 
     private suspend fun executeMappings() {
@@ -179,35 +247,35 @@ class IndexedServiceImpl(private val config: KrapperConfig, private val request:
             it.getFilter(resolver).resolveFilter() to it
         }
 
-        val allElements = classes.recursiveSequence().toList()
+        val filterIndex = FilterIndex(ResolvedFilterModel, classes.recursiveSequence())
+        val allElements = filterIndex.elements
+        mappingsAndFilters.forEach { (filter, _) -> filter.bind(filterIndex) }
         Log.i("Applying mappings to ${allElements.size} elements")
+        val positions = ElementPositions(allElements)
         var matched = 0
         for ((index, element) in allElements.withIndex()) {
             if (index > 0 && index % 500 == 0) {
                 Log.i("  Processed $index/${allElements.size} elements ($matched matched)")
             }
             for ((filter, mapper) in mappingsAndFilters) {
+                if (!positions.isAttached(element)) break
                 if (!filter(element)) continue
                 matched++
-                if (config.debug) {
-                    Log.i("Executing mapping ($mapper) on $element")
-                }
+                Log.d { "Executing mapping ($mapper) on $element" }
 
                 try {
-                    val results = mapper.mapElement(
-                        MapRequest(
-                            element.parent ?: element,
-                            element.parent?.children?.indexOf(element) ?: -1
-                        )
-                    )
-                    if (config.debug) {
-                        Log.i("     --> $results")
+                    val results = Trace.span("mapping", element.toString()) {
+                        mapper.mapElement(positions.request(element))
                     }
-                    for (result in results) {
-                        applyResult(result, element)
+                    Log.d { "     --> $results" }
+                    val touched = results.flatMap { positions.apply(it, element) }
+                    if (touched.isNotEmpty()) {
+                        val affected = filterIndex.update(touched)
+                        mappingsAndFilters.forEach { (filter, _) -> filter.invalidate(affected) }
                     }
                 } catch (t: Throwable) {
-                    Log.w(t.message + "\n" + t.stackTraceToString())
+                    Log.w { t.message + "\n" + t.stackTraceToString() }
+                    Log.flush()
                     throw RuntimeException("Mapping failed for $element", t)
                 }
             }
@@ -215,49 +283,150 @@ class IndexedServiceImpl(private val config: KrapperConfig, private val request:
         Log.i("Mappings complete: $matched matches across ${allElements.size} elements")
     }
 
-    private fun applyResult(result: MapResult, element: ResolvedElement) = when (result) {
-        RemoveChild -> {
-            element.parent?.removeChild(element)
+    override suspend fun close() {
+        super.close()
+        index.dispose()
+        scope.clear()
+    }
+}
+
+/**
+ * Tracks where each element sits in its parent while mappings run, so building a [MapRequest]
+ * doesn't need to search the parent's children. Each child keeps the slot it was given, and a
+ * removal only records its slot, so removing many siblings never renumbers the rest.
+ */
+internal class ElementPositions(elements: List<ResolvedElement>) {
+    private val slots = IdentityMap<ResolvedElement, Int>()
+    private val parents = IdentityMap<ResolvedElement, ParentSlots>()
+    private val detached = IdentityMap<ResolvedElement, Unit>()
+
+    private class ParentSlots(var next: Int) {
+        // Sorted, mappings run in traversal order so removals almost always append.
+        private val removed = mutableListOf<Int>()
+
+        fun removedBefore(slot: Int): Int {
+            val at = removed.binarySearch(slot)
+            return if (at >= 0) at else -at - 1
         }
 
-        RemoveParent -> {
-            element.parent?.let { parent ->
-                parent.parent?.removeChild(parent)
-            }
+        fun remove(slot: Int) {
+            val at = removed.binarySearch(slot)
+            if (at < 0) removed.add(-at - 1, slot)
         }
+    }
 
-        is AddToChild -> {
-            element.addChild(result.newChild)
+    init {
+        for (element in elements) {
+            renumber(element)
         }
+    }
 
-        is AddToParent -> {
-            element.parent?.addChild(result.newChild)
+    fun request(element: ResolvedElement): MapRequest {
+        val parent = element.parent ?: return MapRequest(element, -1)
+        return MapRequest(parent, positionOf(parent, element))
+    }
+
+    /**
+     * Whether [element] is still part of the tree, elements under anything removed or replaced
+     * by an earlier mapping are skipped.
+     */
+    fun isAttached(element: ResolvedElement): Boolean {
+        var current: ResolvedElement? = element
+        while (current != null) {
+            if (detached.containsKey(current)) return false
+            current = current.parent
         }
+        return true
+    }
 
-        is ReplaceChild -> {
-            element.parent?.let { parent ->
-                parent.removeChild(element)
-                parent.addChild(result.newChild)
+    /**
+     * Applies [result] of mapping [element] and returns the elements it added, removed or
+     * replaced, along with the parent whose children changed.
+     */
+    fun apply(result: MapResult, element: ResolvedElement): List<ResolvedElement> {
+        val parent = element.parent
+        return when (result) {
+            RemoveChild -> {
+                parent ?: return emptyList()
+                remove(parent, element)
+                listOf(parent, element)
             }
-        }
 
-        is ReplaceParent -> {
-            element.parent?.let { parent ->
-                parent.parent?.let { parentParent ->
-                    parentParent.removeChild(parent)
-                    parentParent.addChild(result.newChild)
-                }
+            RemoveParent -> {
+                val parentParent = parent?.parent ?: return emptyList()
+                remove(parentParent, parent)
+                listOf(parentParent, parent)
             }
+
+            is AddToChild -> {
+                add(element, result.newChild)
+                listOf(element, result.newChild)
+            }
+
+            is AddToParent -> {
+                parent ?: return emptyList()
+                add(parent, result.newChild)
+                listOf(parent, result.newChild)
+            }
+
+            is ReplaceChild -> {
+                parent ?: return emptyList()
+                replace(parent, element, result.newChild)
+                listOf(parent, element, result.newChild)
+            }
+
+            is ReplaceParent -> {
+                val parentParent = parent?.parent ?: return emptyList()
+                replace(parentParent, parent, result.newChild)
+                listOf(parentParent, parent, result.newChild)
+            }
+
+            NoChange -> emptyList()
         }
+    }
 
-        NoChange -> {
-            // Nothing to do.
+    private fun positionOf(parent: ResolvedElement, element: ResolvedElement): Int {
+        val slot = slots[element]
+        val parentSlots = parents[parent]
+        if (slot != null && parentSlots != null) {
+            val index = slot - parentSlots.removedBefore(slot)
+            if (parent.children.getOrNull(index) === element) return index
         }
+        // The children changed behind our back, start the slots over for this parent.
+        renumber(parent)
+        return parent.children.indexOfFirst { it === element }
     }
 
-    override suspend fun close() {
-        super.close()
-        index.dispose()
-        scope.clear()
+    private fun renumber(parent: ResolvedElement): ParentSlots {
+        parent.children.forEachIndexed { index, child ->
+            slots[child] = index
+        }
+        return ParentSlots(parent.children.size).also { parents[parent] = it }
+    }
+
+    private fun add(parent: ResolvedElement, child: ResolvedElement) {
+        val parentSlots = parents[parent] ?: renumber(parent)
+        parent.addChild(child)
+        slots[child] = parentSlots.next++
+    }
+
+    private fun remove(parent: ResolvedElement, child: ResolvedElement) {
+        val index = positionOf(parent, child)
+        if (index < 0) return
+        parent.removeChildAt(index)
+        detached[child] = Unit
+        slots.remove(child)?.let { parents[parent]?.remove(it) }
+    }
+
+    private fun replace(
+        parent: ResolvedElement,
+        child: ResolvedElement,
+        replacement: ResolvedElement
+    ) {
+        val index = positionOf(parent, child)
+        if (index < 0) return
+        parent.replaceChildAt(index, replacement)
+        detached[child] = Unit
+        slots.remove(child)?.let { slots[replacement] = it }
     }
 }
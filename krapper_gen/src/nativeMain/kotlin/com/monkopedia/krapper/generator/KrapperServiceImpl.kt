@@ -20,6 +20,9 @@ import com.monkopedia.krapper.IndexedService
 import com.monkopedia.krapper.KrapperConfig
 import com.monkopedia.krapper.KrapperService
 import com.monkopedia.krapper.RemoteLogger
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.currentCoroutineContext
 import platform.posix.exit
 
 class KrapperServiceImpl : KrapperService {
@@ -28,11 +31,18 @@ class KrapperServiceImpl : KrapperService {
     override suspend fun ping(message: String): String = "Krapper ping $message"
 
     override suspend fun setLogger(logger: RemoteLogger) {
-        Log.loggerImpl = logger
+        Log.flush()
+        (Log.loggerImpl as? BufferedLogger)?.close()
+        Log.loggerImpl = BufferedLogger(
+            logger,
+            CoroutineScope(currentCoroutineContext() + SupervisorJob())
+        )
     }
 
     override suspend fun setConfig(config: KrapperConfig) {
         this.config = config
+        Log.level = if (config.debug) LogLevel.DEBUG else LogLevel.INFO
+        Trace.enabled = config.trace
     }
 
     override suspend fun getConfig(u: Unit): KrapperConfig =
@@ -42,6 +52,7 @@ class KrapperServiceImpl : KrapperService {
         IndexedServiceImpl(getConfig(Unit), request)
 
     override suspend fun quit(u: Unit) {
+        Log.flush()
         exit(0)
     }
 }
@@ -16,6 +16,14 @@
 package com.monkopedia.krapper.generator
 
 import com.monkopedia.krapper.RemoteLogger
+import com.monkopedia.krapper.generator.LogLevel.DEBUG
+import com.monkopedia.krapper.generator.LogLevel.ERROR
+import com.monkopedia.krapper.generator.LogLevel.INFO
+import com.monkopedia.krapper.generator.LogLevel.WARN
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.launch
 
 object StdOutLogger : RemoteLogger {
     override suspend fun e(message: String) {
@@ -31,18 +39,149 @@ object StdOutLogger : RemoteLogger {
     }
 }
 
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR
+}
+
 object Log {
     var loggerImpl: RemoteLogger = StdOutLogger
+    var level: LogLevel = INFO
+
+    fun isEnabled(level: LogLevel): Boolean = level >= this.level
+
+    suspend fun d(str: String) {
+        if (isEnabled(DEBUG)) loggerImpl.i(str)
+    }
 
     suspend fun w(str: String) {
-        loggerImpl.w(str)
+        if (isEnabled(WARN)) loggerImpl.w(str)
     }
 
     suspend fun e(str: String) {
-        loggerImpl.e(str)
+        if (isEnabled(ERROR)) loggerImpl.e(str)
     }
 
     suspend fun i(str: String) {
-        loggerImpl.i(str)
+        if (isEnabled(INFO)) loggerImpl.i(str)
+    }
+
+    /**
+     * Lazy variants, [message] is only built when the level is enabled.
+     */
+    suspend inline fun d(message: () -> String) {
+        if (isEnabled(DEBUG)) loggerImpl.i(message())
+    }
+
+    suspend inline fun w(message: () -> String) {
+        if (isEnabled(WARN)) loggerImpl.w(message())
+    }
+
+    suspend inline fun e(message: () -> String) {
+        if (isEnabled(ERROR)) loggerImpl.e(message())
+    }
+
+    suspend inline fun i(message: () -> String) {
+        if (isEnabled(INFO)) loggerImpl.i(message())
+    }
+
+    /**
+     * Waits for anything queued in a [BufferedLogger] to be delivered.
+     */
+    suspend fun flush() {
+        (loggerImpl as? BufferedLogger)?.flush()
+    }
+}
+
+/**
+ * Queues messages and delivers them to [target] from a coroutine in [scope], joining
+ * consecutive messages of the same level into a single call. Callers only suspend when
+ * [capacity] messages are already waiting to be sent.
+ */
+class BufferedLogger(
+    private val target: RemoteLogger,
+    scope: CoroutineScope,
+    capacity: Int = 1024,
+    private val maxBatch: Int = 128
+) : RemoteLogger {
+    private sealed class Entry {
+        class Message(val level: LogLevel, val text: String) : Entry()
+        class Flush(val done: CompletableDeferred<Unit>) : Entry()
+    }
+
+    private val pending = Channel<Entry>(capacity)
+
+    init {
+        scope.launch {
+            for (entry in pending) {
+                deliver(entry)
+            }
+        }
+    }
+
+    override suspend fun e(message: String) {
+        pending.send(Entry.Message(ERROR, message))
+    }
+
+    override suspend fun i(message: String) {
+        pending.send(Entry.Message(INFO, message))
+    }
+
+    override suspend fun w(message: String) {
+        pending.send(Entry.Message(WARN, message))
+    }
+
+    suspend fun flush() {
+        val done = CompletableDeferred<Unit>()
+        pending.send(Entry.Flush(done))
+        done.await()
+    }
+
+    fun close() {
+        pending.close()
+    }
+
+    private suspend fun deliver(first: Entry) {
+        val batch = StringBuilder()
+        var batchLevel: LogLevel? = null
+        var count = 0
+        var entry: Entry? = first
+        while (entry != null) {
+            when (entry) {
+                is Entry.Message -> {
+                    if (batchLevel != null && batchLevel != entry.level) {
+                        send(batchLevel, batch)
+                    }
+                    if (batch.isNotEmpty()) batch.append('\n')
+                    batch.append(entry.text)
+                    batchLevel = entry.level
+                }
+
+                is Entry.Flush -> {
+                    batchLevel?.let { send(it, batch) }
+                    batchLevel = null
+                    entry.done.complete(Unit)
+                }
+            }
+            entry = if (++count < maxBatch) pending.tryReceive().getOrNull() else null
+        }
+        batchLevel?.let { send(it, batch) }
+    }
+
+    private suspend fun send(level: LogLevel, batch: StringBuilder) {
+        val message = batch.toString()
+        batch.clear()
+        try {
+            when (level) {
+                ERROR -> target.e(message)
+                WARN -> target.w(message)
+                DEBUG, INFO -> target.i(message)
+            }
+        } catch (t: Throwable) {
+            // Logging should never take down generation, fall back to the local stderr.
+            Utils.printerrln("Failed to deliver log (${t.message}):\n$message")
+        }
     }
 }
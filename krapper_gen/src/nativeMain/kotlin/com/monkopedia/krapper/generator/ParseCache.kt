@@ -0,0 +1,98 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.generator.codegen.File
+import com.monkopedia.krapper.generator.model.WrappedTU
+import com.monkopedia.krapper.generator.model.cloneRecursive
+import com.monkopedia.krapper.generator.model.restoreParents
+
+/**
+ * State kept for the lifetime of the generator process, so a service kept running by the
+ * Gradle plugin doesn't rediscover include paths or reparse headers that haven't changed.
+ */
+object ParseCache {
+    private const val MAX_PARSES = 4
+    private const val MAX_DEPTH = 16
+
+    private val includes = mutableMapOf<String, Array<String>>()
+    private val parses = ArrayDeque<CachedParse>()
+
+    private class CachedParse(val key: List<String>, val fingerprint: String, val tu: WrappedTU)
+
+    fun includePaths(compiler: String): Array<String> =
+        includes.getOrPut("$compiler@${File(compiler).stamp()}") {
+            Trace.span("includeDiscovery", compiler) {
+                generateIncludes(compiler)
+            }
+        }
+
+    suspend fun resolver(
+        headers: List<String>,
+        includePaths: Array<String>,
+        headerDirectories: List<String>,
+        languageStandard: String,
+        parse: suspend () -> Resolver
+    ): Resolver {
+        val key = headers + includePaths + languageStandard
+        val fingerprint = fingerprint(headers, headerDirectories)
+        parses.find { it.key == key && it.fingerprint == fingerprint }?.let { cached ->
+            Log.i("Reusing parse of ${headers.size} headers")
+            parses.remove(cached)
+            parses.addFirst(cached)
+            return ParsedResolver(cached.tu.pristineCopy())
+        }
+        val resolver = parse()
+        val tu = (resolver as? ParsedResolver)?.tu ?: return resolver
+        parses.removeAll { it.key == key }
+        parses.addFirst(CachedParse(key, fingerprint, tu.pristineCopy()))
+        while (parses.size > MAX_PARSES) {
+            parses.removeLast()
+        }
+        return resolver
+    }
+
+    fun clear() {
+        includes.clear()
+        parses.clear()
+    }
+
+    // Resolution modifies the wrapped classes, so callers only ever see copies of the cache.
+    private fun WrappedTU.pristineCopy(): WrappedTU = cloneRecursive().also {
+        restoreParents()
+    }
+
+    private fun fingerprint(headers: List<String>, headerDirectories: List<String>): String =
+        buildString {
+            for (header in headers) {
+                append(header).append('=').append(File(header).stamp()).append('\n')
+            }
+            for (directory in headerDirectories) {
+                appendStamps(File(directory), 0)
+            }
+        }
+
+    private fun StringBuilder.appendStamps(file: File, depth: Int) {
+        if (depth > MAX_DEPTH) return
+        if (file.isDir()) {
+            for (child in file.listFiles().sortedBy { it.name }) {
+                appendStamps(child, depth + 1)
+            }
+        } else {
+            append(file.path).append('=').append(file.stamp()).append('\n')
+        }
+    }
+}
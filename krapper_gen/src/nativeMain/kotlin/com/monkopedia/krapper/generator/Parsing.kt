@@ -26,43 +26,14 @@ import clang.clang_formatDiagnostic
 import clang.clang_getCString
 import clang.clang_getDiagnostic
 import clang.clang_getNumDiagnostics
-import com.monkopedia.krapper.AndFilter
-import com.monkopedia.krapper.DefaultFilter
+import com.monkopedia.krapper.DEFAULT_LANGUAGE_STANDARD
 import com.monkopedia.krapper.FilterDefinition
-import com.monkopedia.krapper.FilterableTypes
-import com.monkopedia.krapper.FilterableTypes.CLASS
-import com.monkopedia.krapper.FilterableTypes.FIELD
-import com.monkopedia.krapper.FilterableTypes.METHOD
-import com.monkopedia.krapper.FilterableTypes.TYPE
-import com.monkopedia.krapper.HierarchyFilter
-import com.monkopedia.krapper.HierarchyTarget.ALL_CHILDREN
-import com.monkopedia.krapper.HierarchyTarget.ANY_CHILD
-import com.monkopedia.krapper.HierarchyTarget.BASE
-import com.monkopedia.krapper.HierarchyTarget.PARENT
-import com.monkopedia.krapper.NotFilter
-import com.monkopedia.krapper.OrFilter
-import com.monkopedia.krapper.StringFilter
-import com.monkopedia.krapper.StringMatcher
-import com.monkopedia.krapper.StringMatcherType.CONTAINS
-import com.monkopedia.krapper.StringMatcherType.ENDS_WITH
-import com.monkopedia.krapper.StringMatcherType.EQUALS
-import com.monkopedia.krapper.StringMatcherType.REGEX
-import com.monkopedia.krapper.StringMatcherType.STARTS_WITH
-import com.monkopedia.krapper.StringSelector
-import com.monkopedia.krapper.StringSelector.CLASS_NAME
-import com.monkopedia.krapper.StringSelector.CLASS_QUALIFIED
-import com.monkopedia.krapper.StringSelector.METHOD_NAME
-import com.monkopedia.krapper.StringSelector.METHOD_RETURN_TYPE
-import com.monkopedia.krapper.StringSelector.METHOD_TYPE
-import com.monkopedia.krapper.StringSelector.NAMESPACE
-import com.monkopedia.krapper.StringSelector.STRINGIFY
-import com.monkopedia.krapper.TypeFilter
 import com.monkopedia.krapper.filter
 import com.monkopedia.krapper.generator.canonicalType
 import com.monkopedia.krapper.generator.codegen.File
 import com.monkopedia.krapper.generator.model.WrappedClass
 import com.monkopedia.krapper.generator.model.WrappedElement
-import com.monkopedia.krapper.generator.model.WrappedField
+import com.monkopedia.krapper.generator.model.WrappedEnum
 import com.monkopedia.krapper.generator.model.WrappedMethod
 import com.monkopedia.krapper.generator.model.WrappedNamespace
 import com.monkopedia.krapper.generator.model.WrappedTU
@@ -73,16 +44,15 @@ import com.monkopedia.krapper.generator.model.cloneRecursive
 import com.monkopedia.krapper.generator.model.filterRecursive
 import com.monkopedia.krapper.generator.model.forEachRecursive
 import com.monkopedia.krapper.generator.model.parentClass
+import com.monkopedia.krapper.generator.model.recursiveSequence
 import com.monkopedia.krapper.generator.model.type.WrappedTemplateRef
 import com.monkopedia.krapper.generator.model.type.WrappedTemplateType
 import com.monkopedia.krapper.generator.model.type.WrappedType
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType.STATIC
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
-import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedNamespace
-import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedType
 import kotlin.math.min
 import kotlinx.cinterop.ByteVar
 import kotlinx.cinterop.CValue
@@ -105,192 +75,11 @@ import platform.posix.write
 
 typealias ElementFilter = WrappedElement.() -> Boolean
 
-fun FilterDefinition.wrapperFilter(): (WrappedElement) -> Boolean {
-    return when (this) {
-        is AndFilter -> {
-            val each = this.elements.map { it.wrapperFilter() }
-            return { element ->
-                each.all { it(element) }
-            }
-        }
-
-        is OrFilter -> {
-            val each = this.elements.map { it.wrapperFilter() }
-            return { element ->
-                each.any { it(element) }
-            }
-        }
-
-        is NotFilter -> {
-            val base = this.base.wrapperFilter()
-            return { element ->
-                !base(element)
-            }
-        }
-
-        DefaultFilter -> {
-            return defaultFilter().wrapperFilter()
-        }
-
-        is HierarchyFilter -> {
-            val base = this.filter.wrapperFilter()
-            return when (this.target) {
-                PARENT -> { element ->
-                    element.parent?.let { base(it) } ?: false
-                }
-
-                BASE -> { element ->
-                    base(element.baseParent)
-                }
-
-                ANY_CHILD -> { element ->
-                    element.children.any(base)
-                }
-
-                ALL_CHILDREN -> { element ->
-                    element.children.all(base)
-                }
-            }
-        }
-
-        is StringFilter -> {
-            return { element ->
-                val str = this.selector.select(element)
-                this.matcher.matches(str)
-            }
-        }
-
-        is TypeFilter -> {
-            return { element ->
-                types.any {
-                    when (it) {
-                        CLASS -> element is WrappedClass
-                        METHOD -> element is WrappedMethod
-                        FIELD -> element is WrappedField
-                        TYPE -> element is WrappedType
-                        FilterableTypes.NAMESPACE -> element is WrappedNamespace
-                    }
-                }
-            }
-        }
-    }
-}
-
-fun FilterDefinition.resolveFilter(): (ResolvedElement) -> Boolean {
-    return when (this) {
-        is AndFilter -> {
-            val each = this.elements.map { it.resolveFilter() }
-            return { element ->
-                each.all { it(element) }
-            }
-        }
+fun FilterDefinition.wrapperFilter(): FilterPlan<WrappedElement> =
+    FilterPlan(this, WrappedFilterModel)
 
-        is OrFilter -> {
-            val each = this.elements.map { it.resolveFilter() }
-            return { element ->
-                each.any { it(element) }
-            }
-        }
-
-        is NotFilter -> {
-            val base = this.base.resolveFilter()
-            return { element ->
-                !base(element)
-            }
-        }
-
-        DefaultFilter -> {
-            return defaultFilter().resolveFilter()
-        }
-
-        is HierarchyFilter -> {
-            val base = this.filter.resolveFilter()
-            return when (this.target) {
-                PARENT -> { element ->
-                    element.parent?.let { base(it) } ?: false
-                }
-
-                BASE -> { element ->
-                    base(element.baseParent)
-                }
-
-                ANY_CHILD -> { element ->
-                    element.children.any(base)
-                }
-
-                ALL_CHILDREN -> { element ->
-                    element.children.all(base)
-                }
-            }
-        }
-
-        is StringFilter -> {
-            return { element ->
-                val str = this.selector.select(element)
-                this.matcher.matches(str)
-            }
-        }
-
-        is TypeFilter -> {
-            return { element ->
-                types.any {
-                    when (it) {
-                        CLASS -> element is ResolvedClass
-                        METHOD -> element is ResolvedMethod
-                        FIELD -> element is ResolvedField
-                        TYPE -> element is ResolvedType
-                        FilterableTypes.NAMESPACE -> element is ResolvedNamespace
-                    }
-                }
-            }
-        }
-    }
-}
-
-private fun StringMatcher.matches(input: String?): Boolean {
-    val target = input ?: return false
-    return when (this.type) {
-        STARTS_WITH -> {
-            target.startsWith(this.str)
-        }
-
-        CONTAINS -> {
-            target.contains(this.str)
-        }
-
-        EQUALS -> {
-            target == this.str
-        }
-
-        ENDS_WITH -> {
-            target.endsWith(this.str)
-        }
-
-        REGEX -> {
-            Regex(this.str).matches(target)
-        }
-    }
-}
-
-private fun StringSelector.select(element: ResolvedElement): String? = when (this) {
-    STRINGIFY -> element.toString()
-    CLASS_NAME -> (element as? ResolvedClass)?.name
-    CLASS_QUALIFIED -> (element as? ResolvedClass)?.type?.type
-    METHOD_NAME -> (element as? ResolvedMethod)?.name
-    METHOD_TYPE -> (element as? ResolvedMethod)?.methodType?.toString()
-    METHOD_RETURN_TYPE -> (element as? ResolvedMethod)?.returnType?.type
-    NAMESPACE -> (element as? ResolvedNamespace)?.namespace
-}
-
-private fun StringSelector.select(element: WrappedElement): String? = when (this) {
-    STRINGIFY -> element.toString()
-    CLASS_NAME -> (element as? WrappedClass)?.name
-    CLASS_QUALIFIED -> (element as? WrappedClass)?.type?.toString()
-    METHOD_NAME -> (element as? WrappedMethod)?.name
-    METHOD_TYPE -> (element as? WrappedMethod)?.methodType?.toString()
-    METHOD_RETURN_TYPE -> (element as? WrappedMethod)?.returnType?.toString()
-    NAMESPACE -> (element as? WrappedNamespace)?.namespace
-}
+fun FilterDefinition.resolveFilter(): FilterPlan<ResolvedElement> =
+    FilterPlan(this, ResolvedFilterModel)
 
 fun defaultFilter(): FilterDefinition = filter {
     (
@@ -383,6 +172,11 @@ fun find(s: String): String? {
 class ParsedResolver(val tu: WrappedTU) : Resolver {
     private val classMap = mutableMapOf<String, Pair<ResolvedClass, WrappedClass>?>()
     private val templateMap = mutableMapOf<String, WrappedTemplate>()
+    private val enumMap by lazy {
+        tu.recursiveSequence().filterIsInstance<WrappedEnum>().associateBy { it.qualified }
+    }
+
+    override fun findEnum(qualified: String): WrappedEnum? = enumMap[qualified]
 
     override fun resolveTemplate(type: WrappedType, context: ResolveContext): WrappedTemplate =
         templateMap.getOrPut(type.toString()) {
@@ -424,15 +218,28 @@ class ParsedResolver(val tu: WrappedTU) : Resolver {
 
     override suspend fun findClasses(filter: ElementFilter): List<WrappedElement> {
         Log.i("Finding classes")
-        return mutableListOf<WrappedElement>().also { ret ->
-            tu.forEachRecursive {
-                if (it.filter() == true) {
-                    ret.add(it)
+        val classes = Trace.span("findClasses") {
+            mutableListOf<WrappedElement>().also { ret ->
+                tu.forEachRecursive {
+                    if (it.filter() == true) {
+                        ret.add(it)
+                    }
                 }
             }
-        }.also {
-            Log.i("Found ${it.size} classes")
         }
+        Log.i("Found ${classes.size} classes")
+        return classes
+    }
+
+    override suspend fun findClasses(plan: FilterPlan<WrappedElement>): List<WrappedElement> {
+        Log.i("Finding classes")
+        val (classes, candidates) = Trace.span("findClasses") {
+            val index = FilterIndex(WrappedFilterModel, tu.recursiveSequence())
+            val candidates = plan.bind(index).candidates() ?: index.elements
+            candidates.filter(plan) to candidates.size
+        }
+        Log.i("Found ${classes.size} classes ($candidates candidates)")
+        return classes
     }
 }
 
@@ -483,14 +290,20 @@ private class ResolverBuilderImpl : ResolverBuilder {
     }
 }
 
+fun parseArgs(
+    includePaths: Array<String>,
+    languageStandard: String = DEFAULT_LANGUAGE_STANDARD
+): Array<String> = arrayOf("-xc++", "--std=$languageStandard") + includePaths.map { "-I$it" }
+
 suspend fun DeferScope.parseHeader(
     index: CXIndex,
     file: List<String>,
     includePaths: Array<String>,
-    args: Array<String> = arrayOf("-xc++", "--std=c++14") + includePaths.map { "-I$it" }
-        .toTypedArray(),
+    languageStandard: String = DEFAULT_LANGUAGE_STANDARD,
+    args: Array<String> = parseArgs(includePaths, languageStandard),
     debug: Boolean = false
 ): Resolver {
+    WrappedElement.resetLookup()
     val builder = ResolverBuilderImpl()
     val tu = file.map { parseHeader(index, it, builder, includePaths, args, debug) }
         .reduceRight { tu1, tu2 ->
@@ -511,11 +324,12 @@ private fun DeferScope.parseHeader(
     file: String,
     resolverBuilder: ResolverBuilder,
     includePaths: Array<String>,
-    args: Array<String> = arrayOf("-xc++", "--std=c++14") + includePaths.map { "-I$it" }
-        .toTypedArray(),
+    args: Array<String> = parseArgs(includePaths),
     debug: Boolean = false
 ): WrappedTU {
-    val tu = index.parseTranslationUnit(file, args, null) ?: error("Failed to parse $file")
+    val tu = Trace.span("parse", file) {
+        index.parseTranslationUnit(file, args, null) ?: error("Failed to parse $file")
+    }
     tu.printDiagnostics()?.let {
         throw RuntimeException("Parse failure: $it")
     }
@@ -529,7 +343,9 @@ private fun DeferScope.parseHeader(
             "cursor_${File(file).name}.json"
         ).writeText(Json.encodeToString(Utils.CursorTreeInfo(cursor)))
     }
-    val element = WrappedElement.mapAll(tu.cursor, resolverBuilder)
+    val element = Trace.span("mapAll", file) {
+        WrappedElement.mapAll(tu.cursor, resolverBuilder)
+    }
     return element as? WrappedTU ?: error("$element is not a WrappedTU, ${tu.cursor.kind}")
 }
 
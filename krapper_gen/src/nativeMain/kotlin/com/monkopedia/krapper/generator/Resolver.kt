@@ -16,6 +16,10 @@
 package com.monkopedia.krapper.generator
 
 import clang.CXType
+import com.monkopedia.krapper.CacheReport
+import com.monkopedia.krapper.DroppedReport
+import com.monkopedia.krapper.ResolutionReport
+import com.monkopedia.krapper.ResolvedClassReport
 import com.monkopedia.krapper.generator.codegen.BasicAssignmentOperator
 import com.monkopedia.krapper.generator.codegen.NameHandler
 import com.monkopedia.krapper.generator.codegen.Namer
@@ -23,13 +27,14 @@ import com.monkopedia.krapper.generator.codegen.Operator
 import com.monkopedia.krapper.generator.model.NullableKotlinType
 import com.monkopedia.krapper.generator.model.TemplatedKotlinType
 import com.monkopedia.krapper.generator.model.WrappedClass
+import com.monkopedia.krapper.generator.model.WrappedConstant
 import com.monkopedia.krapper.generator.model.WrappedElement
+import com.monkopedia.krapper.generator.model.WrappedEnum
 import com.monkopedia.krapper.generator.model.WrappedField
 import com.monkopedia.krapper.generator.model.WrappedKotlinType
 import com.monkopedia.krapper.generator.model.WrappedMethod
 import com.monkopedia.krapper.generator.model.WrappedNamespace
 import com.monkopedia.krapper.generator.model.WrappedTemplate
-import com.monkopedia.krapper.generator.model.parentClass
 import com.monkopedia.krapper.generator.model.type.WrappedModifiedType
 import com.monkopedia.krapper.generator.model.type.WrappedPrefixedType
 import com.monkopedia.krapper.generator.model.type.WrappedTemplateType
@@ -39,9 +44,15 @@ import com.monkopedia.krapper.generator.model.type.WrappedType.Companion.arrayOf
 import com.monkopedia.krapper.generator.model.type.WrappedType.Companion.pointerTo
 import com.monkopedia.krapper.generator.model.type.WrappedType.Companion.referenceTo
 import com.monkopedia.krapper.generator.model.type.WrappedTypeReference
+import com.monkopedia.krapper.generator.model.type.enumType
+import com.monkopedia.krapper.generator.model.type.isEnum
+import com.monkopedia.krapper.generator.model.type.isEnumValue
+import com.monkopedia.krapper.generator.model.type.isView
+import com.monkopedia.krapper.generator.model.type.viewType
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
 import com.monkopedia.krapper.generator.resolvedmodel.type.CastMethod.CAST
+import com.monkopedia.krapper.generator.resolvedmodel.type.CastMethod.ENUM
 import com.monkopedia.krapper.generator.resolvedmodel.type.CastMethod.NATIVE
 import com.monkopedia.krapper.generator.resolvedmodel.type.CastMethod.POINTED_STRING_CAST
 import com.monkopedia.krapper.generator.resolvedmodel.type.CastMethod.STRING_CAST
@@ -49,6 +60,7 @@ import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedCType
 import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedCppType
 import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedKotlinType
 import com.monkopedia.krapper.generator.resolvedmodel.type.nullable
+import kotlin.time.TimeSource
 import kotlinx.cinterop.CValue
 
 interface Resolver {
@@ -58,12 +70,78 @@ interface Resolver {
     ): Pair<ResolvedClass, WrappedClass>?
 
     fun resolveTemplate(type: WrappedType, context: ResolveContext): WrappedTemplate
+
+    /**
+     * Declaration of the enum [qualified], so its constants can be generated.
+     */
+    fun findEnum(qualified: String): WrappedEnum? = null
     suspend fun findClasses(filter: ElementFilter): List<WrappedElement>
+    suspend fun findClasses(plan: FilterPlan<WrappedElement>): List<WrappedElement> =
+        findClasses { plan(this) }
+}
+
+/**
+ * Collects the [ResolutionReport] for a resolve as it happens.
+ */
+class ResolutionStats {
+    private val timeSource = TimeSource.Monotonic
+    private val classTimes = mutableMapOf<String, Long>()
+    // The same failure is hit each time its element is resolved, so it is only reported once.
+    private val dropped = linkedMapOf<Pair<String?, String>, DroppedReport>()
+    private val included = mutableListOf<String>()
+    private var cacheHits = 0L
+    private var cacheMisses = 0L
+
+    inline fun <T> timeClass(type: String, resolve: () -> T): T {
+        val start = mark()
+        try {
+            return resolve()
+        } finally {
+            recordTime(type, start)
+        }
+    }
+
+    fun mark(): TimeSource.Monotonic.ValueTimeMark = timeSource.markNow()
+
+    fun recordTime(type: String, start: TimeSource.Monotonic.ValueTimeMark) {
+        classTimes[type] = (classTimes[type] ?: 0) + start.elapsedNow().inWholeMicroseconds
+    }
+
+    fun dropped(element: WrappedElement?, type: WrappedType?, reason: String) {
+        val report = DroppedReport(element?.toString(), type?.toString(), reason)
+        dropped.getOrPut(report.element to reason) { report }
+    }
+
+    fun included(type: String) {
+        included.add(type)
+    }
+
+    fun cacheLookup(hit: Boolean) {
+        if (hit) cacheHits++ else cacheMisses++
+    }
+
+    fun toReport(resolvedTypes: Collection<String>): ResolutionReport = ResolutionReport(
+        resolvedTypes.map { ResolvedClassReport(it, classTimes[it] ?: 0) },
+        dropped.values.toList(),
+        included.toList(),
+        CacheReport(cacheHits, cacheMisses)
+    )
 }
 
-class ResolveTracker(val classes: MutableMap<String, WrappedClass>) {
+class ResolveTracker(
+    val classes: MutableMap<String, WrappedClass>,
+    val stats: ResolutionStats = ResolutionStats()
+) {
     val resolvedClasses = mutableMapOf<String, ResolvedClass>()
+
+    /**
+     * Enums referenced while resolving, these get their constants generated.
+     */
+    val enums = mutableSetOf<String>()
+
     suspend fun canResolve(type: WrappedType, context: ResolveContext): Boolean {
+        type.enumType?.let { enums.add(it.name) }
+        if (type.isView) return true
         if (type.isArray) return false
         if (type == WrappedType.UNRESOLVABLE) return false
         if (otherResolved.contains(type.toString())) return true
@@ -91,7 +169,16 @@ class ResolveTracker(val classes: MutableMap<String, WrappedClass>) {
         if (cls.isNotEmpty()) {
             try {
                 otherResolved.add(str)
-                resolvedClasses[str] = classes[str]?.resolve(context) ?: return false
+                val resolved = Trace.span("resolveClass", str) {
+                    stats.timeClass(str) {
+                        classes[str]?.resolve(context)
+                    }
+                }
+                if (resolved == null) {
+                    stats.dropped(cls, cls.type, "Class failed to resolve")
+                    return false
+                }
+                resolvedClasses[str] = resolved
                 return resolvedClasses[str]?.isNotEmpty() == true
             } finally {
                 otherResolved.remove(str)
@@ -111,22 +198,18 @@ interface ResolverBuilder {
 
 suspend fun List<WrappedElement>.resolveAll(
     resolver: Resolver,
-    policy: ReferencePolicy
+    policy: ReferencePolicy,
+    stats: ResolutionStats = ResolutionStats()
 ): List<ResolvedElement> {
     val classes = filterIsInstance<WrappedClass>()
     val resolveContext = ResolveContext.Empty
-        .copy(
-            resolver = resolver,
-            debugFilter = { element, type, message ->
-                element?.parentClass?.toString()?.contains("CreateParams") ?: false ||
-                    (element == null && message.contains("CreateParams"))
-            }
-        )
+        .copy(resolver = resolver, tracker = ResolveTracker(mutableMapOf(), stats))
         .withClasses(classes)
         .withPolicy(policy)
     classes.forEach {
         if (resolveContext.resolve(it.type) == null) {
             Log.w("Warning: can't resolve filtered class ${it.type}")
+            stats.dropped(it, it.type, "Filtered class failed to resolve")
         }
     }
     val methods = filterIsInstance<WrappedMethod>().mapNotNull { method ->
@@ -134,7 +217,23 @@ suspend fun List<WrappedElement>.resolveAll(
             method.resolve(resolveContext + nm)
         }
     }
-    return resolveContext.tracker.resolvedClasses.values.toList() + methods
+    // Namespace level constants come along with anything wrapped from the same namespace.
+    val constants = (classes + filterIsInstance<WrappedMethod>())
+        .mapNotNull { it.parent as? WrappedNamespace }
+        .distinct()
+        .flatMap { it.children.filterIsInstance<WrappedConstant>() }
+        .mapNotNull { it.resolve(resolveContext) }
+        .distinctBy { "${it.scope}::${it.name}" }
+    val enums = resolveContext.tracker.enums.toList().mapNotNull { name ->
+        val enum = resolver.findEnum(name)
+            ?: return@mapNotNull resolveContext.notifyFailed<ResolvedElement>(
+                null,
+                null,
+                "Missing declaration for enum $name"
+            )
+        enum.resolve(resolveContext)
+    }
+    return resolveContext.tracker.resolvedClasses.values.toList() + methods + enums + constants
 }
 
 data class ResolveContext(
@@ -150,9 +249,9 @@ data class ResolveContext(
     suspend fun map(type: WrappedType): WrappedType? {
         if (type.isArray) return null
         return when (
-            val mapResult = mappingCache.getOrPut(type) {
-                typeMapping(type, this)
-            }
+            val mapResult = mappingCache[type].also {
+                tracker.stats.cacheLookup(it != null)
+            } ?: typeMapping(type, this).also { mappingCache[type] = it }
         ) {
             RemoveElement -> return null
             ElementUnchanged -> type
@@ -188,7 +287,10 @@ data class ResolveContext(
         copy(currentNamer = namer.namerFor(wrappedClass), mappingCache = mappingCache)
 
     fun withClasses(classes: List<WrappedClass>) = copy(
-        tracker = ResolveTracker(classes.associateBy { it.type.toString() }.toMutableMap()),
+        tracker = ResolveTracker(
+            classes.associateBy { it.type.toString() }.toMutableMap(),
+            tracker.stats
+        ),
         namer = NameHandler()
     )
 
@@ -222,8 +324,9 @@ data class ResolveContext(
         type: WrappedType?,
         message: String
     ): T? {
-        if (debugFilter?.invoke(element, type, message) == true) {
-            Log.w("$element failed resolving $type: $message")
+        tracker.stats.dropped(element, type, message)
+        if (Log.isEnabled(LogLevel.DEBUG) && debugFilter?.invoke(element, type, message) != false) {
+            Log.d { "$element failed resolving $type: $message" }
         }
         return null
     }
@@ -302,6 +405,7 @@ private fun typeMapper(policy: ReferencePolicy): TypeMapping {
                             }
                             context.tracker.resolvedClasses[resolved.type.toString()] = resolved
                             context.tracker.classes[wrapper.type.toString()] = wrapper
+                            context.tracker.stats.included(resolved.type.toString())
                         } finally {
                             context.tracker.otherResolved.remove(t.toString())
                         }
@@ -341,6 +445,9 @@ suspend fun WrappedType.operateOn(typeHandler: suspend (WrappedType) -> MapResul
             }
         }
 
+        // Views are bound as pointer + length, their template args never need resolving.
+        this.isView -> return typeHandler(this)
+
         this is WrappedTemplateType -> return handleTemplate(typeHandler)
 
         this.isPointer -> return (pointed.operateOn(typeHandler)).wrapOnReplace {
@@ -382,15 +489,17 @@ inline fun MapResult.wrapOnReplace(typeWrapping: (WrappedType) -> WrappedType):
 
 fun toResolvedCppType(type: WrappedType) = ResolvedCppType(
     type.toString(),
-    if (type.isPointer) {
-        nullable(toResolvedKotlinType(type.kotlinType))
-    } else {
-        toResolvedKotlinType(type.kotlinType)
+    when {
+        type.isPointer -> nullable(toResolvedKotlinType(type.kotlinType))
+        type.isEnumValue -> toResolvedKotlinType(type.kotlinType).copy(isEnum = true)
+        else -> toResolvedKotlinType(type.kotlinType)
     },
-    toResolvedCType(type.cType),
+    type.viewType?.let { ResolvedCType("const ${it.cElement}*") } ?: toResolvedCType(type.cType),
     when {
+        type.isView -> NATIVE
         type.isString -> STRING_CAST
         type.isPointer && type.pointed.isString -> POINTED_STRING_CAST
+        type.isEnum -> ENUM
         type.isNative || (type.isPointer && type.pointed.isNative) -> NATIVE
         else -> CAST
     }
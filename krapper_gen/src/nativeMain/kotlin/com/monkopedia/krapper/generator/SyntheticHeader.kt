@@ -0,0 +1,117 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+/**
+ * Describes a generated C++ header for scale testing the generator, since the checked in test
+ * headers are tiny and v8 is the only realistic input. Classes are declared in a chain of
+ * [namespaceDepth] nested namespaces, each one inheriting from the one before it up to
+ * [inheritanceDepth] levels, and referring to [templateInstantiations] distinct instantiations
+ * of a template between them.
+ */
+data class SyntheticHeader(
+    val classes: Int,
+    val methodsPerClass: Int = 8,
+    val fieldsPerClass: Int = 4,
+    val inheritanceDepth: Int = 3,
+    val templateInstantiations: Int = 8,
+    val namespaceDepth: Int = 2
+) {
+    val declarationCount: Int
+        get() = classes * (1 + methodsPerClass + fieldsPerClass) + templateInstantiations
+
+    val namespace: String
+        get() = (listOf("synth") + (1..namespaceDepth).map { "level$it" }).joinToString("::")
+
+    fun generate(): String = buildString {
+        appendLine("#pragma once")
+        appendLine()
+        val namespaces = namespace.split("::")
+        for (name in namespaces) {
+            appendLine("namespace $name {")
+        }
+        appendLine()
+        appendLine("template <class T>")
+        appendLine("class Box {")
+        appendLine("  public:")
+        appendLine("    T value;")
+        appendLine("    T get() { return value; }")
+        appendLine("    void set(T v) { value = v; }")
+        appendLine("};")
+        appendLine()
+        for (i in 0 until classes) {
+            appendLine("class Class$i;")
+        }
+        for (i in 0 until classes) {
+            appendLine()
+            appendClass(i)
+        }
+        appendLine()
+        for (name in namespaces.asReversed()) {
+            appendLine("} // namespace $name")
+        }
+    }
+
+    private fun StringBuilder.appendClass(index: Int) {
+        val base = if (inheritanceDepth > 0 && index % (inheritanceDepth + 1) != 0) {
+            " : public Class${index - 1}"
+        } else {
+            ""
+        }
+        appendLine("class Class$index$base {")
+        appendLine("  public:")
+        for (j in 0 until fieldsPerClass) {
+            appendLine("    ${FIELD_TYPES[j % FIELD_TYPES.size]} field${index}_$j;")
+        }
+        for (j in 0 until methodsPerClass) {
+            appendLine("    ${method(index, j)};")
+        }
+        appendLine("};")
+    }
+
+    private fun method(index: Int, j: Int): String {
+        val other = "Class${(index + j + 1) % classes}"
+        return when (j % 4) {
+            0 -> "int method${index}_$j(int a, double b)"
+            1 -> "$other* other${index}_$j()"
+            2 -> "void take${index}_$j($other* value, long count)"
+            else -> if (templateInstantiations > 0) {
+                "Box<${boxArgument((index + j) % templateInstantiations)}>* box${index}_$j()"
+            } else {
+                "double value${index}_$j()"
+            }
+        }
+    }
+
+    private fun boxArgument(index: Int): String =
+        BOX_PRIMITIVES.getOrNull(index) ?: "Class${(index - BOX_PRIMITIVES.size) % classes}*"
+
+    companion object {
+        private val FIELD_TYPES = listOf("int", "double", "long", "bool")
+        private val BOX_PRIMITIVES = listOf("int", "double", "long", "float")
+
+        /**
+         * Header with roughly [count] declarations in the default shape.
+         */
+        fun withDeclarations(count: Int): SyntheticHeader {
+            val shape = SyntheticHeader(1)
+            val perClass = 1 + shape.methodsPerClass + shape.fieldsPerClass
+            return shape.copy(
+                classes = ((count - shape.templateInstantiations) / perClass).coerceAtLeast(1)
+            )
+        }
+    }
+}
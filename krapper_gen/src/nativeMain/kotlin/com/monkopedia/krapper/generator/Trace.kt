@@ -0,0 +1,132 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.generator.codegen.File
+import kotlin.time.TimeSource
+import kotlinx.cinterop.alloc
+import kotlinx.cinterop.memScoped
+import kotlinx.cinterop.ptr
+import kotlinx.serialization.json.Json
+import kotlinx.serialization.json.JsonObject
+import kotlinx.serialization.json.addJsonObject
+import kotlinx.serialization.json.buildJsonObject
+import kotlinx.serialization.json.put
+import kotlinx.serialization.json.putJsonArray
+import kotlinx.serialization.json.putJsonObject
+import platform.posix.RUSAGE_SELF
+import platform.posix.getpid
+import platform.posix.getrusage
+import platform.posix.rusage
+
+/**
+ * Records timed spans of the generator's phases and writes them in the Chrome trace event
+ * format, for loading into chrome://tracing or Perfetto. Spans are only recorded while
+ * [enabled], otherwise [span] just runs its block. Each span also notes the peak RSS at its
+ * end, how far it raised that peak and the minor page faults taken during it, as a measure of
+ * how much memory it touched.
+ */
+object Trace {
+    var enabled: Boolean = false
+
+    private val start = TimeSource.Monotonic.markNow()
+    private val events = mutableListOf<Event>()
+
+    class Event(
+        val name: String,
+        val detail: String?,
+        val startUs: Long,
+        val durationUs: Long,
+        val peakRssKb: Long,
+        val rssGrowthKb: Long,
+        val minorFaults: Long
+    )
+
+    fun now(): Long = start.elapsedNow().inWholeMicroseconds
+
+    fun minorFaults(): Long = usage { it.ru_minflt }
+
+    fun peakRssKb(): Long = usage { it.ru_maxrss }
+
+    private inline fun usage(value: (rusage) -> Long): Long = memScoped {
+        val usage = alloc<rusage>()
+        getrusage(RUSAGE_SELF, usage.ptr)
+        value(usage)
+    }
+
+    fun record(name: String, detail: String?, startUs: Long, startRssKb: Long, startFaults: Long) {
+        val peakRssKb = peakRssKb()
+        events.add(
+            Event(
+                name,
+                detail,
+                startUs,
+                now() - startUs,
+                peakRssKb,
+                peakRssKb - startRssKb,
+                minorFaults() - startFaults
+            )
+        )
+    }
+
+    /**
+     * Returns the spans recorded so far and starts a new trace.
+     */
+    fun drain(): List<Event> = events.toList().also { events.clear() }
+
+    /**
+     * Writes the spans recorded so far to [file] and starts a new trace.
+     */
+    fun writeTo(file: File) {
+        file.writeText(Json.encodeToString(JsonObject.serializer(), toJson(drain())))
+    }
+
+    private fun toJson(events: List<Event>): JsonObject = buildJsonObject {
+        val pid = getpid()
+        putJsonArray("traceEvents") {
+            for (event in events) {
+                addJsonObject {
+                    put("name", event.name)
+                    put("cat", "krapper")
+                    put("ph", "X")
+                    put("ts", event.startUs)
+                    put("dur", event.durationUs)
+                    put("pid", pid)
+                    put("tid", 1)
+                    putJsonObject("args") {
+                        event.detail?.let { put("detail", it) }
+                        put("peakRssKb", event.peakRssKb)
+                        put("rssGrowthKb", event.rssGrowthKb)
+                        put("minorFaults", event.minorFaults)
+                    }
+                }
+            }
+        }
+        put("displayTimeUnit", "ms")
+    }
+}
+
+inline fun <T> Trace.span(name: String, detail: String? = null, block: () -> T): T {
+    if (!enabled) return block()
+    val startUs = now()
+    val startRssKb = peakRssKb()
+    val startFaults = minorFaults()
+    try {
+        return block()
+    } finally {
+        record(name, detail, startUs, startRssKb, startFaults)
+    }
+}
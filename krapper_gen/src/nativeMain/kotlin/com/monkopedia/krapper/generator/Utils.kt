@@ -26,7 +26,7 @@ object Utils {
     val STDERR = platform.posix.fdopen(2, "w")
 
     fun printerrln(message: String) {
-        fprintf(STDERR, message + "\n")
+        fprintf(STDERR, "%s\n", message)
         fflush(STDERR)
     }
 
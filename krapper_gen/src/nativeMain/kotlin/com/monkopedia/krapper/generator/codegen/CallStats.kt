@@ -0,0 +1,322 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.CallInstrumentation
+import com.monkopedia.krapper.CallInstrumentation.COUNT
+import com.monkopedia.krapper.CallInstrumentation.NONE
+import com.monkopedia.krapper.CallInstrumentation.PROBES
+import com.monkopedia.krapper.CallInstrumentation.TIME
+import com.monkopedia.krapper.generator.builders.CodeStringBuilder
+import com.monkopedia.krapper.generator.builders.Raw
+import com.monkopedia.krapper.generator.builders.Symbol
+
+/**
+ * Environment variable that makes an instrumented module dump its stats to stderr at exit.
+ */
+const val CALL_STATS_ENV = "KRAPPER_CALL_STATS"
+
+/**
+ * Prefix of the C functions exposing the call stats of [moduleName], `<prefix>_dump_stats`.
+ */
+fun callStatsPrefix(moduleName: String): String =
+    moduleName.splitCamelcase().joinToString("_") { it.lowercase() }
+
+fun callStatsObject(moduleName: String): String =
+    moduleName.replaceFirstChar { it.uppercase() } + "CallStats"
+
+/**
+ * First statement of an instrumented wrapper, accounting the call to [symbol] against stat [id].
+ */
+fun CallInstrumentation.callStatement(id: Int, symbol: String): Symbol =
+    Raw(callStatementText(id, symbol))
+
+fun CallInstrumentation.callStatementText(id: Int, symbol: String): String = when (this) {
+    NONE -> error("Calls are not instrumented")
+    COUNT -> "krapper_bump(krapper_stat($id).calls, 1)"
+    TIME -> "KrapperCallTimer krapper_timer($id)"
+    PROBES -> "KrapperProbeScope krapper_probe(\"$symbol\")"
+}
+
+fun callStatsDeclarations(prefix: String): List<String> = listOf(
+    "void ${prefix}_dump_stats(void)",
+    "void ${prefix}_reset_stats(void)",
+    "size_t ${prefix}_stats_count(void)",
+    "const char* ${prefix}_stats_name(size_t index)",
+    "void ${prefix}_stats_collect(uint64_t* calls, uint64_t* nanos)"
+)
+
+/**
+ * Verbatim block of C++, which does not get a trailing semicolon.
+ */
+internal class CodeBlock(private val content: () -> String) : Symbol {
+    override val blockSemi: Boolean
+        get() = true
+
+    override fun build(builder: CodeStringBuilder) {
+        builder.append(content().trimEnd())
+    }
+}
+
+/**
+ * Per thread counters and the registry merging them, goes ahead of the wrappers. [names] is
+ * only read when the code is built, so it can be filled in while the wrappers are generated.
+ *
+ * Each thread only ever writes its own counters, so they are bumped with a relaxed load and
+ * store rather than a locked add, and only readers take the registry lock.
+ */
+fun callStatsRuntime(names: List<String>): Symbol = CodeBlock {
+    val slots = maxOf(names.size, 1)
+    val nameList = names.joinToString("") { "    \"$it\",\n" }
+    """
+namespace {
+
+const size_t krapper_stat_count = ${names.size};
+const char* const krapper_stat_names[$slots] = {
+$nameList};
+
+struct KrapperCallStat {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> nanos{0};
+};
+
+inline void krapper_bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+struct KrapperThreadStats;
+
+struct KrapperStatsRegistry {
+    std::mutex lock;
+    std::vector<KrapperThreadStats*> live;
+    uint64_t retired_calls[$slots] = {};
+    uint64_t retired_nanos[$slots] = {};
+    uint64_t baseline_calls[$slots] = {};
+    uint64_t baseline_nanos[$slots] = {};
+};
+
+// Leaked on purpose, thread_local stats can be torn down after static destructors ran.
+KrapperStatsRegistry& krapper_registry() {
+    static KrapperStatsRegistry* registry = new KrapperStatsRegistry();
+    return *registry;
+}
+
+struct KrapperThreadStats {
+    KrapperCallStat stats[$slots];
+
+    KrapperThreadStats() {
+        KrapperStatsRegistry& registry = krapper_registry();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        registry.live.push_back(this);
+    }
+
+    ~KrapperThreadStats() {
+        KrapperStatsRegistry& registry = krapper_registry();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        for (size_t i = 0; i < krapper_stat_count; i++) {
+            registry.retired_calls[i] += stats[i].calls.load(std::memory_order_relaxed);
+            registry.retired_nanos[i] += stats[i].nanos.load(std::memory_order_relaxed);
+        }
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), this));
+    }
+};
+
+inline KrapperCallStat& krapper_stat(size_t id) {
+    thread_local KrapperThreadStats local;
+    return local.stats[id];
+}
+
+struct KrapperCallTimer {
+    KrapperCallStat& stat;
+    std::chrono::steady_clock::time_point start;
+
+    explicit KrapperCallTimer(size_t id)
+        : stat(krapper_stat(id)), start(std::chrono::steady_clock::now()) {
+        krapper_bump(stat.calls, 1);
+    }
+
+    ~KrapperCallTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        krapper_bump(
+            stat.nanos,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+};
+
+// Requires the registry lock.
+void krapper_totals(KrapperStatsRegistry& registry, uint64_t* calls, uint64_t* nanos) {
+    for (size_t i = 0; i < krapper_stat_count; i++) {
+        calls[i] = registry.retired_calls[i];
+        nanos[i] = registry.retired_nanos[i];
+        for (KrapperThreadStats* thread : registry.live) {
+            calls[i] += thread->stats[i].calls.load(std::memory_order_relaxed);
+            nanos[i] += thread->stats[i].nanos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace
+"""
+}
+
+/**
+ * USDT markers around each wrapper, `<prefix>:call__entry` and `<prefix>:call__return` with the
+ * uniqueCName of the wrapper as their argument. They compile to a nop until a tracer attaches,
+ * and to nothing at all where sys/sdt.h is not available.
+ */
+fun callProbesRuntime(prefix: String): Symbol = CodeBlock {
+    """
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#endif
+#endif
+#ifndef DTRACE_PROBE1
+#define DTRACE_PROBE1(provider, name, arg)
+#endif
+
+namespace {
+
+struct KrapperProbeScope {
+    const char* symbol;
+
+    explicit KrapperProbeScope(const char* symbol) : symbol(symbol) {
+        DTRACE_PROBE1($prefix, call__entry, symbol);
+    }
+
+    ~KrapperProbeScope() {
+        DTRACE_PROBE1($prefix, call__return, symbol);
+    }
+};
+
+} // namespace
+"""
+}
+
+/**
+ * The exported C functions reading the stats, goes inside the extern "C" block.
+ */
+fun callStatsFunctions(prefix: String): Symbol = CodeBlock {
+    """
+void ${prefix}_stats_collect(uint64_t* calls, uint64_t* nanos) {
+    KrapperStatsRegistry& registry = krapper_registry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    krapper_totals(registry, calls, nanos);
+    for (size_t i = 0; i < krapper_stat_count; i++) {
+        calls[i] -= registry.baseline_calls[i];
+        nanos[i] -= registry.baseline_nanos[i];
+    }
+}
+
+void ${prefix}_reset_stats(void) {
+    KrapperStatsRegistry& registry = krapper_registry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    krapper_totals(registry, registry.baseline_calls, registry.baseline_nanos);
+}
+
+size_t ${prefix}_stats_count(void) {
+    return krapper_stat_count;
+}
+
+const char* ${prefix}_stats_name(size_t index) {
+    return index < krapper_stat_count ? krapper_stat_names[index] : nullptr;
+}
+
+void ${prefix}_dump_stats(void) {
+    std::vector<uint64_t> calls(krapper_stat_count);
+    std::vector<uint64_t> nanos(krapper_stat_count);
+    ${prefix}_stats_collect(calls.data(), nanos.data());
+    std::vector<size_t> order;
+    for (size_t i = 0; i < krapper_stat_count; i++) {
+        if (calls[i] != 0) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return calls[a] > calls[b];
+    });
+    fprintf(stderr, "%-64s %14s %16s\n", "symbol", "calls", "total ns");
+    for (size_t i : order) {
+        fprintf(stderr, "%-64s %14llu %16llu\n", krapper_stat_names[i],
+            (unsigned long long) calls[i], (unsigned long long) nanos[i]);
+    }
+}
+"""
+}
+
+/**
+ * Hooks up [CALL_STATS_ENV], goes after the extern "C" block.
+ */
+fun callStatsExitDump(prefix: String): Symbol = CodeBlock {
+    """
+namespace {
+
+void krapper_dump_at_exit() {
+    ${prefix}_dump_stats();
+}
+
+struct KrapperExitDump {
+    KrapperExitDump() {
+        if (getenv("$CALL_STATS_ENV") != nullptr) atexit(krapper_dump_at_exit);
+    }
+} krapper_exit_dump;
+
+} // namespace
+"""
+}
+
+/**
+ * Kotlin accessor for the stats of [moduleName], lives next to the cinterop bindings in [pkg].
+ */
+fun callStatsKotlin(pkg: String, moduleName: String): String {
+    val prefix = callStatsPrefix(moduleName)
+    return """
+package $pkg
+
+import kotlinx.cinterop.ULongVar
+import kotlinx.cinterop.allocArray
+import kotlinx.cinterop.convert
+import kotlinx.cinterop.get
+import kotlinx.cinterop.memScoped
+import kotlinx.cinterop.toKString
+
+data class CallStat(val symbol: String, val calls: Long, val nanos: Long)
+
+object ${callStatsObject(moduleName)} {
+    /**
+     * Calls made through the wrappers since the module loaded or the last [reset], busiest first.
+     */
+    fun snapshot(): List<CallStat> = memScoped {
+        val count = ${prefix}_stats_count().toInt()
+        val calls = allocArray<ULongVar>(maxOf(count, 1))
+        val nanos = allocArray<ULongVar>(maxOf(count, 1))
+        ${prefix}_stats_collect(calls, nanos)
+        (0 until count).filter { calls[it] != 0uL }.map {
+            CallStat(
+                ${prefix}_stats_name(it.convert())?.toKString() ?: "",
+                calls[it].toLong(),
+                nanos[it].toLong()
+            )
+        }.sortedByDescending { it.calls }
+    }
+
+    fun reset() = ${prefix}_reset_stats()
+
+    /**
+     * Prints the stats to stderr.
+     */
+    fun dump() = ${prefix}_dump_stats()
+}
+""".trimStart()
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+
+/**
+ * Element of a `std::vector` that can be viewed and copied as raw memory. [kotlinPrimitive] names
+ * both its cinterop `Var` and its Kotlin array, with the matching suffix.
+ */
+data class VectorElement(val cType: String, val kotlinPrimitive: String)
+
+private val vectorElements = mapOf(
+    "char" to "Byte",
+    "signed char" to "Byte",
+    "short" to "Short",
+    "signed short" to "Short",
+    "int" to "Int",
+    "signed int" to "Int",
+    "long" to "Long",
+    "signed long" to "Long",
+    "long long" to "Long",
+    "signed long long" to "Long",
+    "float" to "Float",
+    "double" to "Double"
+)
+
+private val vectorType = Regex("std::vector<\\s*(.+?)\\s*(,\\s*std::allocator<.*>\\s*)?>")
+
+/**
+ * Element of [type] if it is a vector whose contents can be moved around with memcpy.
+ */
+fun vectorElement(type: String): VectorElement? {
+    val match = vectorType.matchEntire(type) ?: return null
+    val cType = match.groupValues[1]
+    return vectorElements[cType]?.let { VectorElement(cType, it) }
+}
+
+val ResolvedClass.vectorElement: VectorElement?
+    get() = vectorElement(type.toString())
+
+val ResolvedClass.vectorDataFunction: String
+    get() = "${cPrefix}_krapper_data"
+
+val ResolvedClass.vectorAssignFunction: String
+    get() = "${cPrefix}_krapper_assign"
+
+/**
+ * C declarations for the header giving direct access to the elements of vector [cls].
+ */
+fun vectorViewDeclarations(cls: ResolvedClass, element: VectorElement): List<String> = listOf(
+    "const ${element.cType}* ${cls.vectorDataFunction}(void* thiz, size_t* size)",
+    "void ${cls.vectorAssignFunction}(void* thiz, const ${element.cType}* values, size_t size)"
+)
+
+/**
+ * Definitions of the element access functions of vector [cls], [countCall] producing the
+ * instrumentation statement for each of them if calls are being instrumented.
+ */
+fun vectorViewFunctions(
+    cls: ResolvedClass,
+    element: VectorElement,
+    countCall: (String) -> String?
+): String = buildString {
+    val cType = element.cType
+    appendLine("const $cType* ${cls.vectorDataFunction}(void* thiz, size_t* size) {")
+    countCall(cls.vectorDataFunction)?.let { appendLine("    $it;") }
+    appendLine("    const ${cls.type}* self = reinterpret_cast<const ${cls.type}*>(thiz);")
+    appendLine("    if (size) {")
+    appendLine("        *size = self->size();")
+    appendLine("    }")
+    appendLine("    return self->data();")
+    appendLine("}")
+    appendLine()
+    appendLine(
+        "void ${cls.vectorAssignFunction}(void* thiz, const $cType* values, size_t size) {"
+    )
+    countCall(cls.vectorAssignFunction)?.let { appendLine("    $it;") }
+    appendLine("    reinterpret_cast<${cls.type}*>(thiz)->assign(values, values + size);")
+    appendLine("}")
+}
+
+/**
+ * Kotlin extensions on the wrapper of vector [cls] exposing its elements as a pointer and copying
+ * them to and from Kotlin arrays with a single native call, using the cinterop bindings in [pkg].
+ */
+fun vectorViewKotlin(cls: ResolvedClass, element: VectorElement, pkg: String): String {
+    val type = cls.type.kotlinType
+    val name = type.name.trimEnd('?')
+    val varType = "${element.kotlinPrimitive}Var"
+    val arrayType = "${element.kotlinPrimitive}Array"
+    val data = cls.vectorDataFunction
+    val assign = cls.vectorAssignFunction
+    return """
+package ${type.pkg}
+
+import $pkg.$assign
+import $pkg.$data
+import kotlinx.cinterop.CPointer
+import kotlinx.cinterop.$varType
+import kotlinx.cinterop.addressOf
+import kotlinx.cinterop.alloc
+import kotlinx.cinterop.convert
+import kotlinx.cinterop.memScoped
+import kotlinx.cinterop.ptr
+import kotlinx.cinterop.sizeOf
+import kotlinx.cinterop.usePinned
+import kotlinx.cinterop.value
+import platform.posix.memcpy
+import platform.posix.size_tVar
+
+// Raw element access for ${cls.type}
+
+/**
+ * First element of the vector, only valid until it is next modified.
+ */
+val $name.dataPointer: CPointer<$varType>?
+    get() = $data(ptr, null)
+
+val $name.elementCount: Int
+    get() {
+        val thiz = ptr
+        return memScoped {
+            val size = alloc<size_tVar>()
+            $data(thiz, size.ptr)
+            size.value.toInt()
+        }
+    }
+
+/**
+ * Copies all the elements out with one native call and a memcpy.
+ */
+fun $name.to$arrayType(): $arrayType {
+    val thiz = ptr
+    return memScoped {
+        val size = alloc<size_tVar>()
+        val data = $data(thiz, size.ptr)
+        val result = $arrayType(size.value.toInt())
+        if (result.isNotEmpty()) {
+            result.usePinned {
+                memcpy(it.addressOf(0), data, (result.size * sizeOf<$varType>()).convert())
+            }
+        }
+        result
+    }
+}
+
+/**
+ * Replaces the contents of the vector with [values] in one native call.
+ */
+fun $name.copyFrom(values: $arrayType) {
+    val thiz = ptr
+    if (values.isEmpty()) {
+        $assign(thiz, null, 0.convert())
+        return
+    }
+    values.usePinned {
+        $assign(thiz, it.addressOf(0), values.size.convert())
+    }
+}
+""".trimStart()
+}
@@ -15,15 +15,20 @@
  */
 package com.monkopedia.krapper.generator.codegen
 
+import com.monkopedia.krapper.DEFAULT_LANGUAGE_STANDARD
 import platform.posix.remove
 import platform.posix.system
 
-class CppCompiler(private val outputFile: File, private val compiler: String) {
+class CppCompiler(
+    private val outputFile: File,
+    private val compiler: String,
+    private val languageStandard: String = DEFAULT_LANGUAGE_STANDARD
+) {
 
     fun compile(cppFile: File, header: List<String>, library: List<String>) {
         val flags = CompileFlags(header, library, linkStatics = true)
-        val command = "$compiler -c -fPIE -o ${outputFile.path} ${flags.includeDirs ?: ""} " +
-            "${flags.linkerOpts ?: ""} ${cppFile.path}"
+        val command = "$compiler -std=$languageStandard -c -fPIE -o ${outputFile.path} " +
+            "${flags.includeDirs ?: ""} ${flags.linkerOpts ?: ""} ${cppFile.path}"
         val logFile = "${outputFile.path}.compile.log"
         val wrappedCommand = "$command >$logFile 2>&1"
         val result = system(wrappedCommand)
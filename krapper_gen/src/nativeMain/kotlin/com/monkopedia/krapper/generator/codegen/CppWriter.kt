@@ -15,6 +15,7 @@
  */
 package com.monkopedia.krapper.generator.codegen
 
+import com.monkopedia.krapper.CallInstrumentation
 import com.monkopedia.krapper.OperatorType.ASSIGN
 import com.monkopedia.krapper.ResolvedOperator
 import com.monkopedia.krapper.generator.builders.Call
@@ -53,6 +54,7 @@ import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.NATIVE
 import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.RAW_CAST
 import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.REINT_CAST
 import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.STD_MOVE
+import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.VIEW
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedConstructor
@@ -69,16 +71,23 @@ import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle.STRING_POINTER
 import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle.VOID
 import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle.VOIDP
 import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle.VOIDP_REFERENCE
+import com.monkopedia.krapper.generator.resolvedmodel.type.CastMethod
+import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedCppType
 import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedType
 
 const val STACK_CONSTRUCTOR_CALLBACK = "StackConstructorCallback"
 class CppWriter(
     private val cppFile: File,
     codeBuilder: CppCodeBuilder,
-    policy: CodeGenerationPolicy = ThrowPolicy
+    policy: CodeGenerationPolicy = ThrowPolicy,
+    private val instrumentation: CallInstrumentation = CallInstrumentation.NONE
 ) : CodeGenerator<CppCodeBuilder>(codeBuilder, policy) {
 
     private var lookup: ClassLookup = ClassLookup(emptyList())
+    private val statNames = mutableListOf<String>()
+    private var needsOffsetOf = false
+    private var needsStringBuffers = false
+    private var needsCursors = false
 
     override fun generate(
         moduleName: String,
@@ -86,6 +95,13 @@ class CppWriter(
         classes: List<ResolvedElement>
     ) {
         lookup = ClassLookup(classes.filterIsInstance<ResolvedClass>())
+        statNames.clear()
+        needsOffsetOf = classes.filterIsInstance<ResolvedClass>().any { cls ->
+            cls.metadata.isPlainStruct || cls.structFields.any { it.offset != null }
+        }
+        needsStringBuffers =
+            classes.filterIsInstance<ResolvedClass>().any { it.stringContainer != null }
+        needsCursors = classes.filterIsInstance<ResolvedClass>().any { it.isIterable }
         super.generate(moduleName, headers, classes)
     }
 
@@ -95,7 +111,43 @@ class CppWriter(
     ) {
         comment("BEGIN KRAPPER GEN for ${cls.type}")
         appendLine()
+        val assertions = if (cls.metadata.isPlainStruct) {
+            plainStructAssertions(cls)
+        } else {
+            fieldOffsetAssertions(cls)
+        }
+        for (assertion in assertions) {
+            +Raw(assertion)
+        }
+        if (assertions.isNotEmpty()) {
+            appendLine()
+        }
         handleChildren()
+        if (cls.snapshotFields.isNotEmpty()) {
+            val functions = snapshotFunctions(cls, ::countStatement)
+            +CodeBlock { functions }
+            appendLine()
+        }
+        cls.vectorElement?.let { element ->
+            val functions = vectorViewFunctions(cls, element, ::countStatement)
+            +CodeBlock { functions }
+            appendLine()
+        }
+        cls.stringContainer?.let { container ->
+            val functions = stringContainerFunctions(cls, container, ::countStatement)
+            +CodeBlock { functions }
+            appendLine()
+        }
+        if (cls.isIterable) {
+            val functions = iterationFunctions(cls, ::countStatement)
+            +CodeBlock { functions }
+            appendLine()
+        }
+        cls.smartPointer?.let { pointer ->
+            val functions = smartPointerFunctions(cls, pointer, ::countStatement)
+            +CodeBlock { functions }
+            appendLine()
+        }
         appendLine()
         comment("END KRAPPER GEN for ${cls.type}")
         appendLine()
@@ -116,6 +168,40 @@ class CppWriter(
         includeSys("vector")
         includeSys("string")
         includeSys("iterator")
+        if (needsOffsetOf) {
+            includeSys("cstddef")
+            includeSys("type_traits")
+        }
+        if (needsStringBuffers) {
+            includeSys("cstdlib")
+            includeSys("cstring")
+        }
+        if (needsCursors) {
+            includeSys("type_traits")
+            includeSys("utility")
+        }
+        if (instrumentation == CallInstrumentation.PROBES) {
+            appendLine()
+            +callProbesRuntime(callStatsPrefix(moduleName))
+        }
+        if (instrumentation.hasStats) {
+            includeSys("algorithm")
+            includeSys("atomic")
+            includeSys("chrono")
+            includeSys("cstdio")
+            includeSys("cstdlib")
+            includeSys("mutex")
+            appendLine()
+            +callStatsRuntime(statNames)
+        }
+        if (needsStringBuffers) {
+            appendLine()
+            +stringBufferRuntime()
+        }
+        if (needsCursors) {
+            appendLine()
+            +iterationRuntime()
+        }
         appendLine()
         +ExternCOpen
         appendLine()
@@ -125,9 +211,34 @@ class CppWriter(
 
         handleChildren()
 
+        val prefix = callStatsPrefix(moduleName)
+        if (instrumentation.hasStats) {
+            appendLine()
+            +callStatsFunctions(prefix)
+        }
+
         appendLine()
         +ExternCClose
         appendLine()
+        if (instrumentation.hasStats) {
+            appendLine()
+            +callStatsExitDump(prefix)
+            appendLine()
+        }
+    }
+
+    private fun CppCodeBuilder.countCall(symbol: String?) {
+        if (instrumentation == CallInstrumentation.NONE) return
+        val symbol = symbol ?: error("Wrapper has no name")
+        +instrumentation.callStatement(statNames.size, symbol)
+        statNames.add(symbol)
+    }
+
+    private fun countStatement(symbol: String): String? {
+        if (instrumentation == CallInstrumentation.NONE) return null
+        return instrumentation.callStatementText(statNames.size, symbol).also {
+            statNames.add(symbol)
+        }
     }
 
     override fun CppCodeBuilder.onGenerate(cls: ResolvedClass, method: ResolvedMethod) {
@@ -135,6 +246,7 @@ class CppWriter(
             generateMethodSignature(method)
             val args = addArgs(method)
             body {
+                countCall(name)
                 generateMethodBody(cls, method, args)
             }
         }
@@ -145,6 +257,7 @@ class CppWriter(
         function {
             val args = generateFieldGet(field)
             body {
+                countCall(name)
                 generateFieldGetBody(cls, field, args)
             }
         }
@@ -152,6 +265,7 @@ class CppWriter(
         function {
             val args = generateFieldSet(field)
             body {
+                countCall(name)
                 generateFieldSetBody(cls, field, args)
             }
         }
@@ -163,6 +277,7 @@ class CppWriter(
             generateMethodSignature(method)
             val args = addArgs(method)
             body {
+                countCall(name)
                 val argCasts = args.map { a ->
                     generateArgumentCast(a)
                 }.toMutableList()
@@ -285,7 +400,7 @@ class CppWriter(
     }
 
     private fun CppCodeBuilder.generateArgumentCast(a: SignatureArgument) = when (a.arg?.castMode) {
-        NATIVE -> a
+        NATIVE, VIEW -> a
         ArgumentCastMode.STRING -> createStringCast(a)
         RAW_CAST -> createRawCast(a)
         STD_MOVE, REINT_CAST, null -> createCast(a)
@@ -305,11 +420,18 @@ class CppWriter(
             STRING -> createStringReturn(call)
             STRING_POINTER -> createPointedStringReturn(call)
             COPY_CONSTRUCTOR -> +Return(New(Call(returnType.toConstructor(), call)))
-            RETURN_REFERENCE -> +Return(call.addressOf)
-            RETURN -> +Return(call)
+            RETURN_REFERENCE -> +Return(castEnum(call.addressOf, returnType))
+            RETURN -> +Return(castEnum(call, returnType))
         }
     }
 
+    private fun castEnum(call: Symbol, returnType: ResolvedType): Symbol =
+        if (returnType is ResolvedCppType && returnType.castMethod == CastMethod.ENUM) {
+            RawCast(returnType.cType.toString(), call)
+        } else {
+            call
+        }
+
     private fun ResolvedType.toConstructor(): String = toString().trimEnd('*').let {
         if (it.startsWith("const ")) {
             it.substring("const ".length)
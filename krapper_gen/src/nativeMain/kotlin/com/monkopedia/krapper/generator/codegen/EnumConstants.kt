@@ -0,0 +1,39 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedEnum
+
+/**
+ * Kotlin source for [enum], a value class over the enum's integer type with each constant in its
+ * companion. The value class is what the wrappers take and return for the enum, and is unwrapped
+ * to the integer at each call so it costs nothing at runtime.
+ */
+fun enumConstantsKotlin(enum: ResolvedEnum): String = buildString {
+    val name = enum.kotlinType.name
+    appendLine("package ${enum.kotlinType.pkg}")
+    appendLine()
+    appendLine("// Constants of ${enum.qualified}")
+    appendLine("@kotlin.jvm.JvmInline")
+    appendLine("value class $name(val value: ${enum.integerType.fullyQualified}) {")
+    appendLine("    companion object {")
+    for (constant in enum.constants) {
+        val value = kotlinLiteral(enum.integerType, constant.value)
+        appendLine("        val ${kotlinName(constant.name)} = $name($value)")
+    }
+    appendLine("    }")
+    appendLine("}")
+}
@@ -74,6 +74,17 @@ data class File(val pathSegments: List<String>) {
         return (stat.st_mode and S_IFMT.toUInt()) == S_IFDIR.toUInt()
     }
 
+    /**
+     * Modification time and size, enough to notice a file changing between parses.
+     */
+    fun stamp(): String? = memScoped {
+        val stat = alloc<stat>()
+        if (stat(path, stat.ptr) != 0) {
+            return null
+        }
+        return "${stat.st_mtim.tv_sec}.${stat.st_mtim.tv_nsec}:${stat.st_size}"
+    }
+
     fun listFiles(): List<File> = memScoped {
         val d = opendir(path) ?: return emptyList()
         defer { closedir(d) }
@@ -15,11 +15,13 @@
  */
 package com.monkopedia.krapper.generator.codegen
 
+import com.monkopedia.krapper.CallInstrumentation
 import com.monkopedia.krapper.generator.builders.CodeGenerationPolicy
 import com.monkopedia.krapper.generator.builders.CodeGenerator
 import com.monkopedia.krapper.generator.builders.CppCodeBuilder
 import com.monkopedia.krapper.generator.builders.ExternCClose
 import com.monkopedia.krapper.generator.builders.ExternCOpen
+import com.monkopedia.krapper.generator.builders.Raw
 import com.monkopedia.krapper.generator.builders.ThrowPolicy
 import com.monkopedia.krapper.generator.builders.appendLine
 import com.monkopedia.krapper.generator.builders.comment
@@ -33,8 +35,11 @@ import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
 
-class HeaderWriter(codeBuilder: CppCodeBuilder, policy: CodeGenerationPolicy = ThrowPolicy) :
-    CodeGenerator<CppCodeBuilder>(codeBuilder, policy) {
+class HeaderWriter(
+    codeBuilder: CppCodeBuilder,
+    policy: CodeGenerationPolicy = ThrowPolicy,
+    private val instrumentation: CallInstrumentation = CallInstrumentation.NONE
+) : CodeGenerator<CppCodeBuilder>(codeBuilder, policy) {
 
     private var lookup: ClassLookup = ClassLookup(emptyList())
 
@@ -53,7 +58,41 @@ class HeaderWriter(codeBuilder: CppCodeBuilder, policy: CodeGenerationPolicy = T
     ) {
         comment("BEGIN KRAPPER GEN for ${cls.type}")
         appendLine()
+        if (cls.metadata.isPlainStruct) {
+            +Raw(plainStructDeclaration(cls))
+            appendLine()
+        }
         handleChildren()
+        if (cls.snapshotFields.isNotEmpty()) {
+            for (declaration in snapshotDeclarations(cls)) {
+                +Raw(declaration)
+                appendLine()
+            }
+        }
+        cls.vectorElement?.let { element ->
+            for (declaration in vectorViewDeclarations(cls, element)) {
+                +Raw(declaration)
+                appendLine()
+            }
+        }
+        if (cls.stringContainer != null) {
+            for (declaration in stringContainerDeclarations(cls)) {
+                +Raw(declaration)
+                appendLine()
+            }
+        }
+        if (cls.isIterable) {
+            for (declaration in iterationDeclarations(cls)) {
+                +Raw(declaration)
+                appendLine()
+            }
+        }
+        cls.smartPointer?.let { pointer ->
+            for (declaration in smartPointerDeclarations(cls, pointer)) {
+                +Raw(declaration)
+                appendLine()
+            }
+        }
         appendLine()
         comment("END KRAPPER GEN for ${cls.type}")
         appendLine()
@@ -83,6 +122,12 @@ class HeaderWriter(codeBuilder: CppCodeBuilder, policy: CodeGenerationPolicy = T
 
             this.handleChildren()
 
+            if (instrumentation.hasStats) {
+                for (declaration in callStatsDeclarations(callStatsPrefix(moduleName))) {
+                    +Raw(declaration)
+                }
+            }
+
             appendLine()
             ifdef("__cplusplus") {
                 +ExternCClose
@@ -0,0 +1,277 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.generator.builders.Symbol
+import com.monkopedia.krapper.generator.resolvedmodel.MethodType
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
+import com.monkopedia.krapper.generator.resolvedmodel.type.CastMethod
+
+/**
+ * Whether [this] class has `begin()` and `end()` members returning the same iterator type, so
+ * one cursor can hold both. vector<bool> is left out since its elements have no address, other
+ * iterators whose elements turn out to have no address are caught by krapper_walkable and
+ * iterate as empty.
+ */
+val ResolvedClass.isIterable: Boolean
+    get() {
+        if (type.toString().startsWith("std::vector<bool")) return false
+        val members = children.filterIsInstance<ResolvedMethod>().filter { method ->
+            method.methodType == MethodType.METHOD && method.args.all { it.name == "thiz" }
+        }
+        val begins = members.filter { it.name == "begin" }.map { it.returnType }
+        val ends = members.filter { it.name == "end" }.map { it.returnType.toString() }
+        return begins.any { begin ->
+            begin.toString() in ends && !begin.isVoid &&
+                (begin.castMethod != CastMethod.NATIVE || begin.toString().endsWith("*"))
+        }
+    }
+
+val ResolvedClass.iterateFunction: String
+    get() = "${cPrefix}_krapper_iterate"
+
+val ResolvedClass.fillFunction: String
+    get() = "${cPrefix}_krapper_fill"
+
+val ResolvedClass.closeFunction: String
+    get() = "${cPrefix}_krapper_close"
+
+/**
+ * C declarations for the header walking [cls] in batches: a cursor is opened on an instance,
+ * filled with element addresses until it comes back short, and closed.
+ */
+fun iterationDeclarations(cls: ResolvedClass): List<String> = listOf(
+    "void* ${cls.iterateFunction}(void* thiz)",
+    "size_t ${cls.fillFunction}(void* cursor, void** out, size_t capacity)",
+    "void ${cls.closeFunction}(void* cursor)"
+)
+
+/**
+ * Cursors holding a position within a container between batches. Containers of pointers yield
+ * the pointers themselves, anything else yields the address of each element.
+ */
+fun iterationRuntime(): Symbol = CodeBlock {
+    """
+namespace {
+
+template <typename T>
+void* krapper_element(T& value) {
+    return const_cast<void*>(static_cast<const void*>(&value));
+}
+
+template <typename T>
+void* krapper_element(T* value) {
+    return const_cast<void*>(static_cast<const void*>(value));
+}
+
+struct KrapperCursor {
+    virtual ~KrapperCursor() {}
+    virtual size_t fill(void** out, size_t capacity) = 0;
+};
+
+template <typename It>
+struct KrapperRange : KrapperCursor {
+    It next;
+    It end;
+
+    KrapperRange(It next, It end) : next(next), end(end) {}
+
+    size_t fill(void** out, size_t capacity) override {
+        size_t count = 0;
+        while (count < capacity && next != end) {
+            out[count++] = krapper_element(*next);
+            ++next;
+        }
+        return count;
+    }
+};
+
+// Whether begin and end share a type and each element has an address, or is a pointer itself.
+template <typename Begin, typename End, typename = void>
+struct krapper_walkable : std::false_type {};
+
+template <typename It>
+struct krapper_walkable<It, It, decltype(void(krapper_element(*std::declval<It&>())))>
+    : std::true_type {};
+
+template <typename It>
+KrapperCursor* krapper_cursor(It begin, It end, std::true_type) {
+    return new KrapperRange<It>(begin, end);
+}
+
+// Proxy elements or a separate sentinel type can't be walked, these iterate as empty.
+template <typename Begin, typename End>
+KrapperCursor* krapper_cursor(Begin, End, std::false_type) {
+    return nullptr;
+}
+
+template <typename Begin, typename End>
+KrapperCursor* krapper_cursor(Begin begin, End end) {
+    return krapper_cursor(begin, end, krapper_walkable<Begin, End>());
+}
+
+} // namespace
+"""
+}
+
+/**
+ * Definitions of the iteration functions of [cls], [countCall] producing the instrumentation
+ * statement for each of them if calls are being instrumented.
+ */
+fun iterationFunctions(cls: ResolvedClass, countCall: (String) -> String?): String = buildString {
+    appendLine("void* ${cls.iterateFunction}(void* thiz) {")
+    countCall(cls.iterateFunction)?.let { appendLine("    $it;") }
+    appendLine("    ${cls.type}* self = reinterpret_cast<${cls.type}*>(thiz);")
+    appendLine("    return krapper_cursor(self->begin(), self->end());")
+    appendLine("}")
+    appendLine()
+    appendLine("size_t ${cls.fillFunction}(void* cursor, void** out, size_t capacity) {")
+    countCall(cls.fillFunction)?.let { appendLine("    $it;") }
+    appendLine("    return reinterpret_cast<KrapperCursor*>(cursor)->fill(out, capacity);")
+    appendLine("}")
+    appendLine()
+    appendLine("void ${cls.closeFunction}(void* cursor) {")
+    appendLine("    delete reinterpret_cast<KrapperCursor*>(cursor);")
+    appendLine("}")
+}
+
+/**
+ * Kotlin side of the cursors, shared by every iterable class and placed next to the cinterop
+ * bindings in [pkg].
+ */
+fun iterationKotlin(pkg: String): String = """
+package $pkg
+
+import kotlinx.cinterop.COpaquePointer
+import kotlinx.cinterop.COpaquePointerVar
+import kotlinx.cinterop.CPointer
+import kotlinx.cinterop.allocArray
+import kotlinx.cinterop.convert
+import kotlinx.cinterop.free
+import kotlinx.cinterop.get
+import kotlinx.cinterop.nativeHeap
+import platform.posix.size_t
+
+/**
+ * Walks a native cursor, fetching [batch] elements per native call into a native buffer. The
+ * cursor and buffer are released once the elements run out or [close] is called. Modifying the
+ * container while its cursor is open is undefined behavior, as it is for the C++ iterators the
+ * cursor holds.
+ */
+class KrapperCursor(
+    private var cursor: COpaquePointer?,
+    private val batch: Int,
+    private val fill: (COpaquePointer?, CPointer<COpaquePointerVar>?, size_t) -> size_t,
+    private val release: (COpaquePointer?) -> Unit
+) : Iterator<COpaquePointer?> {
+    private var buffer: CPointer<COpaquePointerVar>? = nativeHeap.allocArray(batch)
+    private var count = 0
+    private var index = 0
+
+    override fun hasNext(): Boolean {
+        if (index < count) return true
+        val cursor = cursor
+        val buffer = buffer
+        if (cursor == null || buffer == null) {
+            close()
+            return false
+        }
+        count = fill(cursor, buffer, batch.convert()).toInt()
+        index = 0
+        if (count < batch) {
+            // Nothing left to fetch, the buffer stays until the rest of this batch is read.
+            release(cursor)
+            this.cursor = null
+        }
+        if (count == 0) {
+            close()
+        }
+        return count > 0
+    }
+
+    override fun next(): COpaquePointer? {
+        if (!hasNext()) throw NoSuchElementException()
+        return buffer!![index++]
+    }
+
+    fun close() {
+        cursor?.let(release)
+        cursor = null
+        buffer?.let { nativeHeap.free(it) }
+        buffer = null
+        count = 0
+        index = 0
+    }
+}
+""".trimStart()
+
+/**
+ * Kotlin extensions on the wrapper of [cls] iterating it in batches, using the cinterop bindings
+ * in [pkg].
+ */
+fun iterationExtensionsKotlin(cls: ResolvedClass, pkg: String): String {
+    val type = cls.type.kotlinType
+    val name = type.name.trimEnd('?')
+    return """
+package ${type.pkg}
+
+import $pkg.KrapperCursor
+import $pkg.${cls.closeFunction}
+import $pkg.${cls.fillFunction}
+import $pkg.${cls.iterateFunction}
+import kotlinx.cinterop.COpaquePointer
+
+// Batched iteration for ${cls.type}
+
+/**
+ * Cursor over the elements, which has to be walked to the end or closed. The container must not
+ * be modified while it is open.
+ */
+fun $name.elementCursor(batch: Int = 64): KrapperCursor {
+    require(batch > 0) { "Batch size must be positive" }
+    return KrapperCursor(
+        ${cls.iterateFunction}(ptr),
+        batch,
+        { cursor, out, capacity -> ${cls.fillFunction}(cursor, out, capacity) },
+        { cursor -> ${cls.closeFunction}(cursor) }
+    )
+}
+
+/**
+ * Elements from begin() to end(), fetched [batch] at a time and copied out before returning, so
+ * no native cursor is left open. These are the elements themselves for containers of pointers
+ * and the address of each element otherwise. Use [useElements] to stop without reading them all.
+ */
+fun $name.elements(batch: Int = 64): List<COpaquePointer?> = useElements(batch) { it.toList() }
+
+/**
+ * Runs [block] over the elements, closing the native cursor however far it got. The container
+ * must not be modified until [block] returns.
+ */
+inline fun <R> $name.useElements(
+    batch: Int = 64,
+    block: (Sequence<COpaquePointer?>) -> R
+): R {
+    val cursor = elementCursor(batch)
+    try {
+        return block(Sequence { cursor })
+    } finally {
+        cursor.close()
+    }
+}
+""".trimStart()
+}
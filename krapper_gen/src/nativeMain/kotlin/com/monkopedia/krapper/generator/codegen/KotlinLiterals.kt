@@ -0,0 +1,58 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedKotlinType
+
+private val kotlinKeywords = setOf(
+    "as", "break", "class", "continue", "do", "else", "false", "for", "fun", "if", "in",
+    "interface", "is", "null", "object", "package", "return", "super", "this", "throw", "true",
+    "try", "typealias", "typeof", "val", "var", "when", "while"
+)
+
+/**
+ * [name] escaped so it can be declared in Kotlin.
+ */
+fun kotlinName(name: String): String = if (name in kotlinKeywords) "`$name`" else name
+
+/**
+ * `const val` declaration of [name] as [type], [value] being the decimal text clang folded it to.
+ */
+fun kotlinConstVal(name: String, type: ResolvedKotlinType, value: String): String =
+    "const val ${kotlinName(name)}: ${type.name} = ${kotlinLiteral(type, value)}"
+
+/**
+ * Literal of [type] for [value], the decimal text clang folded a constant to.
+ */
+fun kotlinLiteral(type: ResolvedKotlinType, value: String): String =
+    when (type.fullyQualified) {
+        "kotlin.Boolean" -> (value != "0").toString()
+        "kotlin.Int" -> if (value == Int.MIN_VALUE.toString()) "Int.MIN_VALUE" else value
+        "kotlin.Long" ->
+            if (value == Long.MIN_VALUE.toString()) "Long.MIN_VALUE" else "${value}L"
+        "kotlin.UByte", "kotlin.UShort", "kotlin.UInt" -> "${value}u"
+        "kotlin.ULong" -> "${value}uL"
+        "kotlin.Float" -> floatingLiteral("Float", value, suffix = "f")
+        "kotlin.Double" -> floatingLiteral("Double", value, suffix = "")
+        else -> value
+    }
+
+private fun floatingLiteral(type: String, value: String, suffix: String): String = when (value) {
+    "NaN" -> "$type.NaN"
+    "Infinity" -> "$type.POSITIVE_INFINITY"
+    "-Infinity" -> "$type.NEGATIVE_INFINITY"
+    else -> if (value.any { it == '.' || it == 'E' }) value + suffix else "$value.0$suffix"
+}
@@ -33,6 +33,7 @@ import com.monkopedia.krapper.generator.builders.KotlinFactory.Companion.STABLE_
 import com.monkopedia.krapper.generator.builders.KotlinFactory.Companion.STABLE_REF_CREATE
 import com.monkopedia.krapper.generator.builders.KotlinFactory.Companion.STATIC_C_FUNCTION
 import com.monkopedia.krapper.generator.builders.KotlinLocalVar
+import com.monkopedia.krapper.generator.builders.KotlinType
 import com.monkopedia.krapper.generator.builders.LocalVar
 import com.monkopedia.krapper.generator.builders.Raw
 import com.monkopedia.krapper.generator.builders.Return
@@ -57,6 +58,7 @@ import com.monkopedia.krapper.generator.builders.infix
 import com.monkopedia.krapper.generator.builders.inline
 import com.monkopedia.krapper.generator.builders.isVal
 import com.monkopedia.krapper.generator.builders.lambda
+import com.monkopedia.krapper.generator.builders.op
 import com.monkopedia.krapper.generator.builders.operator
 import com.monkopedia.krapper.generator.builders.pkg
 import com.monkopedia.krapper.generator.builders.property
@@ -65,8 +67,10 @@ import com.monkopedia.krapper.generator.builders.reference
 import com.monkopedia.krapper.generator.builders.setter
 import com.monkopedia.krapper.generator.builders.symbol
 import com.monkopedia.krapper.generator.builders.type
+import com.monkopedia.krapper.generator.model.type.viewType
 import com.monkopedia.krapper.generator.resolvedmodel.AllocationStyle.DIRECT
 import com.monkopedia.krapper.generator.resolvedmodel.AllocationStyle.STACK
+import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.VIEW
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType.CONSTRUCTOR
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType.DESTRUCTOR
@@ -75,10 +79,13 @@ import com.monkopedia.krapper.generator.resolvedmodel.MethodType.ALIGN_OF
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType.SIZE_OF
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType.STATIC
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType.STATIC_OP
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedArgument
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedConstant
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedConstructor
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedDestructor
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedEnum
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
 import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle
@@ -92,8 +99,11 @@ import com.monkopedia.krapper.generator.resolvedmodel.type.fullyQualifiedType
 import com.monkopedia.krapper.generator.resolvedmodel.type.nullable
 import com.monkopedia.krapper.generator.resolvedmodel.type.typedWith
 
-class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = ThrowPolicy) :
-    CodeGeneratorBase<KotlinCodeBuilder>(policy) {
+class KotlinWriter(
+    private val pkg: String,
+    policy: CodeGenerationPolicy = ThrowPolicy,
+    private val callStatsModule: String? = null
+) : CodeGeneratorBase<KotlinCodeBuilder>(policy) {
     private var currentClasses = mapOf<String, ResolvedClass>()
     private var needsCCaller = false
     private val staticRouterPkg = "krapper.static"
@@ -111,11 +121,51 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
         currentClasses =
             classes.filterIsInstance<ResolvedClass>().associateBy { it.type.toString() }
         for (cls in currentClasses.values) {
-            val clsFile =
-                File(outputDir, cls.type.kotlinType.fullyQualified.replace(".", "_") + ".kt")
+            val fileName = cls.type.kotlinType.fullyQualified.replace(".", "_")
+            val clsFile = File(outputDir, "$fileName.kt")
             val builder = KotlinCodeBuilder()
             builder.generate(cls)
             clsFile.writeText(builder.toString())
+            if (cls.snapshotFields.isNotEmpty()) {
+                File(outputDir, "${fileName}_Snapshot.kt")
+                    .writeText(snapshotKotlin(cls, pkg))
+            }
+            cls.vectorElement?.let { element ->
+                File(outputDir, "${fileName}_Elements.kt")
+                    .writeText(vectorViewKotlin(cls, element, pkg))
+            }
+            cls.stringContainer?.let { container ->
+                File(outputDir, "${fileName}_Elements.kt")
+                    .writeText(stringContainerKotlin(cls, container, pkg))
+            }
+            if (cls.isIterable) {
+                File(outputDir, "${fileName}_Iteration.kt")
+                    .writeText(iterationExtensionsKotlin(cls, pkg))
+            }
+            cls.smartPointer?.let { pointer ->
+                File(outputDir, "${fileName}_Ownership.kt").writeText(
+                    smartPointerKotlin(cls, pointer, currentClasses[pointer.pointee], pkg)
+                )
+            }
+        }
+        for (enum in classes.filterIsInstance<ResolvedEnum>()) {
+            File(outputDir, enum.kotlinType.fullyQualified.replace(".", "_") + ".kt")
+                .writeText(enumConstantsKotlin(enum))
+        }
+        val constantsByScope = classes.filterIsInstance<ResolvedConstant>().groupBy { it.scope }
+        for ((scope, constants) in constantsByScope) {
+            val clsFile = File(outputDir, "${scope.replace("::", "_")}_Constants.kt")
+            val builder = KotlinCodeBuilder()
+            val pkg = scope.split("::").joinToString(".") { it.decapitalize() }
+            builder.pkg(pkg)
+            builder.comment("BEGIN KRAPPER GEN for $pkg Constants")
+            for (constant in constants) {
+                builder.apply {
+                    +Raw(kotlinConstVal(constant.name, constant.kotlinType, constant.value))
+                }
+            }
+            builder.comment("END KRAPPER GEN for $pkg Constants")
+            clsFile.writeText(builder.toString())
         }
         val methodsByPkg = classes.filterIsInstance<ResolvedMethod>().groupBy { it.qualified }
         for ((qualified, methods) in methodsByPkg) {
@@ -168,6 +218,17 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
 
             clsFile.writeText(builder.toString())
         }
+        if (currentClasses.values.any { it.stringContainer != null }) {
+            File(outputDir, "_Krapper_Buffers.kt").writeText(stringBufferKotlin(pkg))
+        }
+        if (currentClasses.values.any { it.isIterable }) {
+            File(outputDir, "_Krapper_Cursor.kt").writeText(iterationKotlin(pkg))
+        }
+        if (callStatsModule != null) {
+            File(outputDir, "_Krapper_Call_Stats.kt").writeText(
+                callStatsKotlin(pkg, callStatsModule)
+            )
+        }
     }
 
     override fun KotlinCodeBuilder.onGenerate(
@@ -186,6 +247,16 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
         cls(named(type), listOf(property(ptr), property(memScope))) {
             handleSuperClassesRecursive(cls)
             handleChildren()
+            if (cls.metadata.isPlainStruct) {
+                // The struct itself, for copying the whole thing out with readValue().
+                +property(define("struct", structType(cls))) {
+                    getter = inline(
+                        getter {
+                            +Return(pointedStruct(cls))
+                        }
+                    )
+                }
+            }
         }
         appendLine()
         comment("END KRAPPER GEN for ${cls.type}")
@@ -229,6 +300,9 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
             }
         }
         companion {
+            for (constant in cls.children.filterIsInstance<ResolvedConstant>()) {
+                +Raw(kotlinConstVal(constant.name, constant.kotlinType, constant.value))
+            }
             val sizeOf = methods.find { (it as? ResolvedMethod)?.methodType == SIZE_OF }!!
             val size = define(
                 "size",
@@ -339,16 +413,13 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
                 val returnType = method.returnType
                 val returnStyle = method.returnStyle
                 retType = type(returnType)
-                var args = if (method.args.isNotEmpty()) {
-                    method.args.map {
-                        define(it.name, it.type)
-                    }
-                } else {
-                    emptyList()
+                val params = method.args
+                val args = params.map {
+                    define(it.name, it.type)
                 }
                 body {
                     generateMethodBody(
-                        args.map { reference(it) },
+                        passArgs(args, params),
                         returnStyle,
                         method.returnType,
                         uniqueCName
@@ -413,10 +484,12 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
             receiver = fqType(MEM_SCOPE)
             name = cls.type.kotlinType.name
             retType = type(ResolvedType.UNIT.copy())
-            val args = method.args.subList(1, method.args.size).map {
+            // The last argument is the callback, which isn't passed through.
+            val params = method.args.drop(1).dropLast(1)
+            val args = params.map {
                 define(it.name, it.type)
-            }.toMutableList()
-            val callbackArg = args.removeLast()
+            }
+            val callbackArg = define(method.args.last().name, method.args.last().type)
             body {
                 val lambda = +define(
                     "callback",
@@ -454,7 +527,7 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
                     uniqueCName,
                     *(
                         listOf(stableRef.reference dot Call("asCPointer")) +
-                            args.map { reference(it) } +
+                            passArgs(args, params) +
                             extensionMethod(staticRouter)
                         ).toTypedArray()
                 )
@@ -476,7 +549,8 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
             receiver = fqType(MEM_SCOPE)
             name = cls.type.kotlinType.name
             retType = type(cls.type)
-            val args = method.args.subList(1, method.args.size).map {
+            val params = method.args.drop(1)
+            val args = params.map {
                 define(it.name, it.type)
             }
             body {
@@ -501,7 +575,7 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
                     initializer = (
                         Call(
                             uniqueCName,
-                            *(listOf(memory.reference) + args.map { reference(it) })
+                            *(listOf(memory.reference) + passArgs(args, params))
                                 .toTypedArray()
                         ) elvis Call("error", "Creation failed".symbol)
                         )
@@ -575,19 +649,13 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
             val returnType = method.returnType
             val returnStyle = method.returnStyle
             retType = type(returnType)
-            var args = if (method.args.isNotEmpty()) {
-                method.args.subList(
-                    if (skipFirstArg) 1 else 0,
-                    method.args.size
-                ).map {
-                    define(it.name, it.type)
-                }
-            } else {
-                emptyList()
+            val params = method.args.drop(if (skipFirstArg) 1 else 0)
+            val args = params.map {
+                define(it.name, it.type)
             }
             body {
                 generateMethodBody(
-                    startArgs + args.map { reference(it) },
+                    startArgs + passArgs(args, params),
                     returnStyle,
                     method.returnType,
                     uniqueCName
@@ -693,6 +761,35 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
         return reference(type, v)
     }
 
+    /**
+     * References [vars] for a call, [args] being the arguments they were defined from. Views
+     * expand into a pinned pointer and a length, matching the size parameter the C++ wrapper
+     * adds after each view.
+     */
+    private fun KotlinCodeBuilder.passArgs(
+        vars: List<LocalVar>,
+        args: List<ResolvedArgument>
+    ): List<Symbol> {
+        require(vars.size == args.size) { "Mismatched arguments $vars for $args" }
+        return vars.zip(args).flatMap { (v, arg) -> passArg(v, arg) }
+    }
+
+    private fun KotlinCodeBuilder.passArg(v: LocalVar, arg: ResolvedArgument): List<Symbol> {
+        if (arg.castMode != VIEW) return listOf(reference(v))
+        val data = if (viewType(arg.type.toString())?.isString == true) {
+            +define("${v.name}Bytes", initializer = v.reference dot Call("encodeToByteArray"))
+                .also { it.isVal = true }
+        } else {
+            v
+        }
+        return listOf(
+            data.reference dot Raw("takeIf { it.isNotEmpty() }") qdot
+                Call(extensionMethod("kotlinx.cinterop", "refTo"), Raw("0")),
+            data.reference dot Raw("size") dot
+                Call(extensionMethod("kotlinx.cinterop", "convert"))
+        )
+    }
+
     private fun reference(type: ResolvedKotlinType?, v: LocalVar): Symbol =
         if (type != null && type.isWrapper) {
             if (type.toString().endsWith("?")) {
@@ -700,11 +797,21 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
             } else {
                 v.reference dot ptr
             }
+        } else if (type != null && type.isEnum) {
+            v.reference dot Raw("value")
         } else {
             v.reference
         }
 
     override fun KotlinCodeBuilder.onGenerate(cls: ResolvedClass, field: ResolvedField) {
+        if (cls.metadata.isPlainStruct) {
+            generateStructField(cls, field)
+            return
+        }
+        if (field.offset != null) {
+            generateOffsetField(field, field.offset)
+            return
+        }
         +property(define(field.name, field.kotlinType)) {
             getter = inline(
                 getter {
@@ -730,6 +837,54 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
         }
     }
 
+    private fun KotlinCodeBuilder.generateStructField(cls: ResolvedClass, field: ResolvedField) {
+        +property(define(field.name, field.kotlinType)) {
+            getter = inline(
+                getter {
+                    +Return(pointedStruct(cls) dot Raw(field.name))
+                }
+            )
+            if (!field.isConst) {
+                setter = inline(
+                    setter { value ->
+                        +(pointedStruct(cls) dot Raw(field.name)).op("=", value.reference)
+                    }
+                )
+            }
+        }
+    }
+
+    private fun KotlinCodeBuilder.generateOffsetField(field: ResolvedField, offset: Long) {
+        +property(define(field.name, field.kotlinType)) {
+            getter = inline(
+                getter {
+                    +Return(pointedAt(field, offset))
+                }
+            )
+            if (!field.isConst) {
+                setter = inline(
+                    setter { value ->
+                        +pointedAt(field, offset).op("=", value.reference)
+                    }
+                )
+            }
+        }
+    }
+
+    private fun pointedAt(field: ResolvedField, offset: Long): Symbol = Call(
+        extensionMethod("kotlinx.cinterop", "interpretPointed"),
+        listOf(KotlinType(fullyQualifiedType("kotlinx.cinterop.${field.kotlinType.name}Var"))),
+        (ptr dot Raw("rawValue")).op("+", Raw("${offset}L"))
+    ) dot Raw("value")
+
+    private fun structType(cls: ResolvedClass): ResolvedKotlinType =
+        fullyQualifiedType("$pkg.${cls.structName}")
+
+    private fun pointedStruct(cls: ResolvedClass): Symbol = ptr dot Call(
+        extensionMethod("kotlinx.cinterop", "reinterpret"),
+        listOf(KotlinType(structType(cls)))
+    ) dot extensionMethod("kotlinx.cinterop", "pointed")
+
     private fun CodeBuilder<KotlinFactory>.generateReturn(
         returnType: ResolvedKotlinType,
         call: Call,
@@ -750,6 +905,10 @@ class KotlinWriter(private val pkg: String, policy: CodeGenerationPolicy = Throw
                 )
             }
 
+            returnType.isEnum -> {
+                +Return(Call(constructorMethod(returnType), call))
+            }
+
             returnType.fullyQualified == "kotlin.String" -> {
                 generateStringReturn(
                     call,
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
+
+private val nonIdentifier = Regex("[^A-Za-z0-9_]")
+
+/**
+ * The class type flattened into a C identifier, for the helpers generated next to its wrappers.
+ */
+val ResolvedClass.cPrefix: String
+    get() = type.toString().replace("::", "_").replace(nonIdentifier, "_")
+
+/**
+ * Name of the C struct mirroring a plain struct class, which cinterop turns into a `CStructVar`.
+ */
+val ResolvedClass.structName: String
+    get() = "${cPrefix}_Struct"
+
+val ResolvedClass.structFields: List<ResolvedField>
+    get() = children.filterIsInstance<ResolvedField>()
+
+/**
+ * C declaration of [cls]'s struct for the header, its fields in declaration order so the layout
+ * matches the C++ class.
+ */
+fun plainStructDeclaration(cls: ResolvedClass): String = buildString {
+    appendLine("typedef struct ${cls.structName} {")
+    for (field in cls.structFields) {
+        appendLine("    ${field.getter.returnType.cType.type} ${field.name};")
+    }
+    append("} ${cls.structName}")
+}
+
+/**
+ * Compile time checks in the wrappers that the header struct still lines up with [cls].
+ */
+fun plainStructAssertions(cls: ResolvedClass): List<String> {
+    val message = "\"${cls.type} no longer matches ${cls.structName}\""
+    return listOf(
+        "static_assert(sizeof(${cls.type}) == sizeof(${cls.structName}), $message)"
+    ) + cls.structFields.map {
+        "static_assert(offsetof(${cls.type}, ${it.name}) == " +
+            "offsetof(${cls.structName}, ${it.name}), $message)"
+    }
+}
+
+/**
+ * Compile time checks in the wrappers that the offsets Kotlin reads fields of [cls] at still hold
+ * for the target being built.
+ */
+fun fieldOffsetAssertions(cls: ResolvedClass): List<String> {
+    val offsets = cls.structFields.mapNotNull { field ->
+        field.offset?.let {
+            "static_assert(offsetof(${cls.type}, ${field.name}) == $it, " +
+                "\"${cls.type}::${field.name} moved, regenerate the wrappers\")"
+        }
+    }
+    if (offsets.isEmpty()) return offsets
+    return listOf(
+        "static_assert(std::is_standard_layout<${cls.type}>::value, " +
+            "\"${cls.type} is not standard layout, regenerate the wrappers\")"
+    ) + offsets
+}
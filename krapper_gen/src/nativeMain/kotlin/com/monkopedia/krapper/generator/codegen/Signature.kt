@@ -19,18 +19,22 @@ import com.monkopedia.krapper.generator.builders.Call
 import com.monkopedia.krapper.generator.builders.FunctionBuilder
 import com.monkopedia.krapper.generator.builders.LangFactory
 import com.monkopedia.krapper.generator.builders.LocalVar
+import com.monkopedia.krapper.generator.builders.RawCast
 import com.monkopedia.krapper.generator.builders.Symbol
 import com.monkopedia.krapper.generator.builders.dereference
 import com.monkopedia.krapper.generator.builders.reference
 import com.monkopedia.krapper.generator.builders.type
+import com.monkopedia.krapper.generator.model.type.viewType
 import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.REINT_CAST
 import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.STD_MOVE
+import com.monkopedia.krapper.generator.resolvedmodel.ArgumentCastMode.VIEW
 import com.monkopedia.krapper.generator.resolvedmodel.MethodType
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedArgument
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
 import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle
 import com.monkopedia.krapper.generator.resolvedmodel.ReturnStyle.ARG_CAST
+import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedCType
 import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedCppType
 import com.monkopedia.krapper.generator.resolvedmodel.type.ResolvedType.Companion.VOID
 
@@ -64,7 +68,14 @@ inline fun <T : LangFactory> FunctionBuilder<T>.generateMethodSignature(method:
         }
     }
 
-data class SignatureArgument(val arg: ResolvedArgument, val localVar: LocalVar) {
+/**
+ * [sizeVar] is only set for VIEW arguments, which arrive as a pointer and a length.
+ */
+data class SignatureArgument(
+    val arg: ResolvedArgument,
+    val localVar: LocalVar,
+    val sizeVar: LocalVar? = null
+) {
     val targetType: ResolvedCppType
         get() = arg.signatureType
     private val needsDereference: Boolean
@@ -72,9 +83,21 @@ data class SignatureArgument(val arg: ResolvedArgument, val localVar: LocalVar)
     val reference: Symbol
         get() = when {
             arg.castMode == STD_MOVE -> Call("std::move", localVar.dereference)
+            arg.castMode == VIEW -> viewReference()
             needsDereference -> localVar.dereference
             else -> localVar.reference
         }
+
+    private fun viewReference(): Symbol {
+        val view = viewType(arg.type.toString()) ?: error("${arg.type} is not a view")
+        val data = if (view.element != view.cElement) {
+            RawCast("const ${view.element}*", localVar.reference)
+        } else {
+            localVar.reference
+        }
+        return Call(view.cppType, data, sizeVar?.reference ?: error("Missing size for ${arg.name}"))
+    }
+
     val pointerReference: Symbol
         get() {
             require(needsDereference) {
@@ -106,7 +129,15 @@ inline fun <T : LangFactory> FunctionBuilder<T>.addArgs(
 }
 
 fun <T : LangFactory> FunctionBuilder<T>.defineWrapperArgument(arg: ResolvedArgument) =
-    SignatureArgument(arg, define(arg.name, arg.signatureType.cType))
+    if (arg.castMode == VIEW) {
+        SignatureArgument(
+            arg,
+            define(arg.name, arg.signatureType.cType),
+            define("${arg.name}_size", ResolvedCType("size_t"))
+        )
+    } else {
+        SignatureArgument(arg, define(arg.name, arg.signatureType.cType))
+    }
 
 inline fun <T : LangFactory> FunctionBuilder<T>.generateFieldGet(
     field: ResolvedField
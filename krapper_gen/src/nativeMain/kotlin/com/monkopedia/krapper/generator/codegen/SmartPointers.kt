@@ -0,0 +1,181 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+
+/**
+ * A `std::unique_ptr` ([isUnique]) or `std::shared_ptr` of [pointee], the C++ type it owns.
+ */
+data class SmartPointer(val pointee: String, val isUnique: Boolean)
+
+private val uniquePointerType =
+    Regex("std::unique_ptr<\\s*([^\\[\\]]+?)\\s*(,\\s*[^,]+)?>")
+private val sharedPointerType = Regex("std::shared_ptr<\\s*([^\\[\\]]+?)\\s*>")
+
+/**
+ * Which smart pointer [type] is, if it is one krapper knows how to transfer ownership through.
+ */
+fun smartPointer(type: String): SmartPointer? {
+    val pointer = uniquePointerType.matchEntire(type)?.let { SmartPointer(it.groupValues[1], true) }
+        ?: sharedPointerType.matchEntire(type)?.let { SmartPointer(it.groupValues[1], false) }
+        ?: return null
+    // A template pointee can be cut short at one of its own commas.
+    return pointer.takeIf { it.pointee.count('<'::equals) == it.pointee.count('>'::equals) }
+}
+
+val ResolvedClass.smartPointer: SmartPointer?
+    get() = smartPointer(type.toString())
+
+private fun ResolvedClass.pointerFunction(name: String) = "${cPrefix}_krapper_$name"
+
+/**
+ * C declarations for the header moving ownership in and out of smart pointer [cls].
+ */
+fun smartPointerDeclarations(cls: ResolvedClass, pointer: SmartPointer): List<String> =
+    listOfNotNull(
+        "void* ${cls.pointerFunction("get")}(void* thiz)",
+        "void* ${cls.pointerFunction("release")}(void* thiz)".takeIf { pointer.isUnique },
+        "void ${cls.pointerFunction("reset")}(void* thiz, void* value)",
+        "void ${cls.pointerFunction("move")}(void* thiz, void* from)",
+        "long ${cls.pointerFunction("use_count")}(void* thiz)".takeUnless { pointer.isUnique }
+    )
+
+/**
+ * Definitions of the ownership functions of [cls], [countCall] producing the instrumentation
+ * statement for each of them if calls are being instrumented.
+ */
+fun smartPointerFunctions(
+    cls: ResolvedClass,
+    pointer: SmartPointer,
+    countCall: (String) -> String?
+): String = buildString {
+    val self = "    ${cls.type}* self = reinterpret_cast<${cls.type}*>(thiz);"
+    fun function(signature: String, name: String, vararg body: String) {
+        if (isNotEmpty()) appendLine()
+        appendLine("$signature {")
+        countCall(cls.pointerFunction(name))?.let { appendLine("    $it;") }
+        appendLine(self)
+        body.forEach { appendLine("    $it") }
+        appendLine("}")
+    }
+    function(
+        "void* ${cls.pointerFunction("get")}(void* thiz)",
+        "get",
+        "return const_cast<void*>(static_cast<const void*>(self->get()));"
+    )
+    if (pointer.isUnique) {
+        function(
+            "void* ${cls.pointerFunction("release")}(void* thiz)",
+            "release",
+            "return const_cast<void*>(static_cast<const void*>(self->release()));"
+        )
+    }
+    function(
+        "void ${cls.pointerFunction("reset")}(void* thiz, void* value)",
+        "reset",
+        "if (value) {",
+        "    self->reset(static_cast<${pointer.pointee}*>(value));",
+        "} else {",
+        "    self->reset();",
+        "}"
+    )
+    function(
+        "void ${cls.pointerFunction("move")}(void* thiz, void* from)",
+        "move",
+        "*self = std::move(*reinterpret_cast<${cls.type}*>(from));"
+    )
+    if (!pointer.isUnique) {
+        function(
+            "long ${cls.pointerFunction("use_count")}(void* thiz)",
+            "use_count",
+            "return self->use_count();"
+        )
+    }
+}
+
+/**
+ * Kotlin extensions on the wrapper of smart pointer [cls], using the cinterop bindings in [pkg].
+ * The object it owns comes back as its wrapper when [pointee] is wrapped, otherwise as a raw
+ * pointer.
+ */
+fun smartPointerKotlin(
+    cls: ResolvedClass,
+    pointer: SmartPointer,
+    pointee: ResolvedClass?,
+    pkg: String
+): String = buildString {
+    val type = cls.type.kotlinType
+    val name = type.name.trimEnd('?')
+    val pointeeType = pointee?.type?.kotlinType
+    val pointeeName = pointeeType?.name?.trimEnd('?')
+    val functions = listOfNotNull(
+        "get",
+        "move",
+        "release".takeIf { pointer.isUnique },
+        "reset",
+        "use_count".takeUnless { pointer.isUnique }
+    )
+    appendLine("package ${type.pkg}")
+    appendLine()
+    for (function in functions) {
+        appendLine("import $pkg.${cls.pointerFunction(function)}")
+    }
+    if (pointeeType != null && pointeeType.pkg != type.pkg) {
+        appendLine("import ${pointeeType.pkg}.$pointeeName")
+    }
+    appendLine("import kotlinx.cinterop.COpaquePointer")
+    appendLine()
+    appendLine("// Ownership for ${cls.type}")
+    appendLine()
+    appendLine("/**")
+    appendLine(" * The object currently owned, only valid for as long as it stays owned.")
+    appendLine(" */")
+    if (pointeeName != null) {
+        appendLine("fun $name.pointee(): $pointeeName? =")
+        appendLine("    ${cls.pointerFunction("get")}(ptr)?.let { $pointeeName(it, memScope) }")
+    } else {
+        appendLine("fun $name.pointee(): COpaquePointer? = ${cls.pointerFunction("get")}(ptr)")
+    }
+    if (pointer.isUnique) {
+        appendLine()
+        appendLine("/**")
+        appendLine(" * Gives up the object without deleting it, the caller now has to delete it.")
+        appendLine(" */")
+        appendLine(
+            "fun $name.releaseOwnership(): COpaquePointer? = ${cls.pointerFunction("release")}(ptr)"
+        )
+    }
+    appendLine()
+    appendLine("/**")
+    appendLine(" * Drops the current object and takes ownership of [value], which has to have been")
+    appendLine(" * allocated with new, for example one returned by releaseOwnership().")
+    appendLine(" */")
+    appendLine("fun $name.takeOwnership(value: COpaquePointer?) =")
+    appendLine("    ${cls.pointerFunction("reset")}(ptr, value)")
+    appendLine()
+    appendLine("fun $name.clear() = takeOwnership(null)")
+    appendLine()
+    appendLine("/**")
+    appendLine(" * Moves ownership out of [other] into this pointer, leaving [other] empty.")
+    appendLine(" */")
+    appendLine("fun $name.moveFrom(other: $name) = ${cls.pointerFunction("move")}(ptr, other.ptr)")
+    if (!pointer.isUnique) {
+        appendLine()
+        appendLine("val $name.useCount: Long")
+        appendLine("    get() = ${cls.pointerFunction("use_count")}(ptr)")
+    }
+}
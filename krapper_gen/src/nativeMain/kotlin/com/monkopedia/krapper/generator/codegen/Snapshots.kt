@@ -0,0 +1,146 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.generator.model.isPrimitive
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
+
+/**
+ * Fields copied by the snapshot of [this] class in a single call, empty when it gets no snapshot
+ * because its fields are already read without crossing into C++ or there are too few to batch.
+ */
+val ResolvedClass.snapshotFields: List<ResolvedField>
+    get() {
+        if (metadata.isPlainStruct) return emptyList()
+        val fields = structFields.filter { it.isPrimitive }
+        return fields.takeIf { it.size > 1 && it.any { field -> field.offset == null } }
+            ?: emptyList()
+    }
+
+val ResolvedClass.snapshotStructName: String
+    get() = "${cPrefix}_Snapshot"
+
+val ResolvedClass.snapshotFunction: String
+    get() = "${cPrefix}_krapper_snapshot"
+
+val ResolvedClass.restoreFunction: String
+    get() = "${cPrefix}_krapper_restore"
+
+private val ResolvedClass.hasRestore: Boolean
+    get() = snapshotFields.any { !it.isConst }
+
+/**
+ * C declarations for the header: the struct the fields are copied through and the functions
+ * filling it from an instance and writing it back.
+ */
+fun snapshotDeclarations(cls: ResolvedClass): List<String> = listOfNotNull(
+    buildString {
+        appendLine("typedef struct ${cls.snapshotStructName} {")
+        for (field in cls.snapshotFields) {
+            appendLine("    ${field.getter.returnType.cType.type} ${field.name};")
+        }
+        append("} ${cls.snapshotStructName}")
+    },
+    "void ${cls.snapshotFunction}(void* thiz, ${cls.snapshotStructName}* out)",
+    "void ${cls.restoreFunction}(void* thiz, const ${cls.snapshotStructName}* in)"
+        .takeIf { cls.hasRestore }
+)
+
+/**
+ * Definitions of the snapshot functions of [cls], [countCall] producing the instrumentation
+ * statement for each of them if calls are being instrumented.
+ */
+fun snapshotFunctions(cls: ResolvedClass, countCall: (String) -> String?): String = buildString {
+    appendLine("void ${cls.snapshotFunction}(void* thiz, ${cls.snapshotStructName}* out) {")
+    countCall(cls.snapshotFunction)?.let { appendLine("    $it;") }
+    appendLine("    const ${cls.type}* self = reinterpret_cast<const ${cls.type}*>(thiz);")
+    for (field in cls.snapshotFields) {
+        val cType = field.getter.returnType.cType.type
+        appendLine("    out->${field.name} = static_cast<$cType>(self->${field.name});")
+    }
+    appendLine("}")
+    if (!cls.hasRestore) return@buildString
+    appendLine()
+    appendLine("void ${cls.restoreFunction}(void* thiz, const ${cls.snapshotStructName}* in) {")
+    countCall(cls.restoreFunction)?.let { appendLine("    $it;") }
+    appendLine("    ${cls.type}* self = reinterpret_cast<${cls.type}*>(thiz);")
+    for (field in cls.snapshotFields.filter { !it.isConst }) {
+        appendLine(
+            "    self->${field.name} = " +
+                "static_cast<decltype(self->${field.name})>(in->${field.name});"
+        )
+    }
+    appendLine("}")
+}
+
+/**
+ * Kotlin side of the snapshot of [cls]: a data class holding the fields and extensions on the
+ * wrapper copying them out and back in one call each, using the cinterop bindings in [pkg].
+ */
+fun snapshotKotlin(cls: ResolvedClass, pkg: String): String = buildString {
+    val type = cls.type.kotlinType
+    val name = type.name.trimEnd('?')
+    val snapshot = "${name}Snapshot"
+    val fields = cls.snapshotFields
+    appendLine("package ${type.pkg}")
+    appendLine()
+    appendLine("import kotlinx.cinterop.alloc")
+    appendLine("import kotlinx.cinterop.memScoped")
+    appendLine("import kotlinx.cinterop.ptr")
+    if (cls.hasRestore) {
+        appendLine("import $pkg.${cls.restoreFunction}")
+    }
+    appendLine("import $pkg.${cls.snapshotFunction}")
+    appendLine("import $pkg.${cls.snapshotStructName}")
+    appendLine()
+    appendLine("// Public primitive fields of ${cls.type}")
+    appendLine("data class $snapshot(")
+    appendLine(
+        fields.joinToString(",\n") { "    val ${kotlinName(it.name)}: ${it.kotlinType.name}" }
+    )
+    appendLine(")")
+    appendLine()
+    appendLine("/**")
+    appendLine(" * Reads every field in [$snapshot] with a single call into C++.")
+    appendLine(" */")
+    appendLine("fun $name.snapshotFields(): $snapshot {")
+    appendLine("    val thiz = ptr")
+    appendLine("    return memScoped {")
+    appendLine("        val out = alloc<${cls.snapshotStructName}>()")
+    appendLine("        ${cls.snapshotFunction}(thiz, out.ptr)")
+    appendLine("        $snapshot(")
+    appendLine(fields.joinToString(",\n") { "            out.${kotlinName(it.name)}" })
+    appendLine("        )")
+    appendLine("    }")
+    appendLine("}")
+    if (!cls.hasRestore) return@buildString
+    appendLine()
+    appendLine("/**")
+    appendLine(" * Writes back every non-const field of [snapshot] with a single call into C++.")
+    appendLine(" */")
+    appendLine("fun $name.restoreFields(snapshot: $snapshot) {")
+    appendLine("    val thiz = ptr")
+    appendLine("    memScoped {")
+    appendLine("        val values = alloc<${cls.snapshotStructName}>()")
+    for (field in fields.filter { !it.isConst }) {
+        val fieldName = kotlinName(field.name)
+        appendLine("        values.$fieldName = snapshot.$fieldName")
+    }
+    appendLine("        ${cls.restoreFunction}(thiz, values.ptr)")
+    appendLine("    }")
+    appendLine("}")
+}
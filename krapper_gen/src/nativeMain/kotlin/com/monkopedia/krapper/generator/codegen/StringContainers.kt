@@ -0,0 +1,353 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.codegen
+
+import com.monkopedia.krapper.generator.builders.Symbol
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+
+/**
+ * Container of strings whose contents are moved across in one buffer: a vector of strings when
+ * [value] is null, otherwise a map from strings to [value].
+ */
+data class StringContainer(val value: BufferValue?)
+
+/**
+ * Value type of a string keyed map, [kotlinType] being what it is on the Kotlin side and [bytes]
+ * how much space it takes in the buffer, null for strings which are length prefixed.
+ */
+data class BufferValue(val cppType: String, val kotlinType: String, val bytes: Int?) {
+    /**
+     * Fixed width type the value is converted to in the buffer, since the size of types like
+     * long differs between targets.
+     */
+    val wireType: String
+        get() = when {
+            bytes == null || kotlinType == "Float" || kotlinType == "Double" -> cppType
+            else -> "int${bytes * 8}_t"
+        }
+}
+
+private val bufferValues = mapOf(
+    "std::string" to BufferValue("std::string", "String", null),
+    "char" to BufferValue("char", "Byte", 1),
+    "signed char" to BufferValue("signed char", "Byte", 1),
+    "short" to BufferValue("short", "Short", 2),
+    "int" to BufferValue("int", "Int", 4),
+    "long" to BufferValue("long", "Long", 8),
+    "long long" to BufferValue("long long", "Long", 8),
+    "float" to BufferValue("float", "Float", 4),
+    "double" to BufferValue("double", "Double", 8)
+)
+
+private val stringVectorType =
+    Regex("std::vector<\\s*std::string\\s*(,\\s*std::allocator<.*>\\s*)?>")
+private val stringMapType =
+    Regex("std::map<\\s*std::string\\s*,\\s*(.+?)\\s*(,\\s*std::less<.*>\\s*)?>")
+
+/**
+ * How [type] is packed into a buffer, if it is a container of strings that can be.
+ */
+fun stringContainer(type: String): StringContainer? {
+    if (stringVectorType.matches(type)) return StringContainer(null)
+    val value = stringMapType.matchEntire(type)?.groupValues?.get(1) ?: return null
+    return bufferValues[value]?.let(::StringContainer)
+}
+
+val ResolvedClass.stringContainer: StringContainer?
+    get() = stringContainer(type.toString())
+
+val ResolvedClass.packFunction: String
+    get() = "${cPrefix}_krapper_pack"
+
+val ResolvedClass.unpackFunction: String
+    get() = "${cPrefix}_krapper_unpack"
+
+/**
+ * C declarations for the header moving the contents of [cls] in and out as one buffer. Packed
+ * buffers are allocated with malloc and owned by the caller.
+ */
+fun stringContainerDeclarations(cls: ResolvedClass): List<String> = listOf(
+    "int8_t* ${cls.packFunction}(void* thiz, size_t* size)",
+    "void ${cls.unpackFunction}(void* thiz, const int8_t* buffer, size_t size)"
+)
+
+/**
+ * Reading and writing of the buffers, every string is prefixed with its length and every value
+ * is stored little endian so both sides agree on the layout. Reads fail rather than run past
+ * the end of the buffer.
+ */
+fun stringBufferRuntime(): Symbol = CodeBlock {
+    """
+namespace {
+
+template <size_t N> struct KrapperBits;
+template <> struct KrapperBits<1> { typedef uint8_t type; };
+template <> struct KrapperBits<2> { typedef uint16_t type; };
+template <> struct KrapperBits<4> { typedef uint32_t type; };
+template <> struct KrapperBits<8> { typedef uint64_t type; };
+
+template <typename T>
+void krapper_put(std::string& out, T value) {
+    typedef typename KrapperBits<sizeof(T)>::type Bits;
+    Bits bits;
+    memcpy(&bits, &value, sizeof(T));
+    for (size_t i = 0; i < sizeof(T); i++) {
+        out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+    }
+}
+
+template <typename T>
+bool krapper_get(const char*& in, const char* end, T& value) {
+    if (static_cast<size_t>(end - in) < sizeof(T)) return false;
+    typedef typename KrapperBits<sizeof(T)>::type Bits;
+    Bits bits = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        bits |= static_cast<Bits>(static_cast<unsigned char>(*in++)) << (8 * i);
+    }
+    memcpy(&value, &bits, sizeof(T));
+    return true;
+}
+
+void krapper_put(std::string& out, const std::string& value) {
+    krapper_put(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+bool krapper_get(const char*& in, const char* end, std::string& value) {
+    uint32_t length;
+    if (!krapper_get(in, end, length) || static_cast<size_t>(end - in) < length) return false;
+    value.assign(in, length);
+    in += length;
+    return true;
+}
+
+int8_t* krapper_release(const std::string& buffer, size_t* size) {
+    *size = buffer.size();
+    int8_t* out = static_cast<int8_t*>(malloc(buffer.size() ? buffer.size() : 1));
+    memcpy(out, buffer.data(), buffer.size());
+    return out;
+}
+
+} // namespace
+"""
+}
+
+/**
+ * Definitions of the buffer functions of [cls], [countCall] producing the instrumentation
+ * statement for each of them if calls are being instrumented.
+ */
+fun stringContainerFunctions(
+    cls: ResolvedClass,
+    container: StringContainer,
+    countCall: (String) -> String?
+): String = buildString {
+    appendLine("int8_t* ${cls.packFunction}(void* thiz, size_t* size) {")
+    countCall(cls.packFunction)?.let { appendLine("    $it;") }
+    appendLine("    const ${cls.type}* self = reinterpret_cast<const ${cls.type}*>(thiz);")
+    appendLine("    std::string out;")
+    appendLine("    for (const auto& entry : *self) {")
+    if (container.value == null) {
+        appendLine("        krapper_put(out, entry);")
+    } else {
+        appendLine("        krapper_put(out, entry.first);")
+        val second = if (container.value.bytes == null) {
+            "entry.second"
+        } else {
+            "static_cast<${container.value.wireType}>(entry.second)"
+        }
+        appendLine("        krapper_put(out, $second);")
+    }
+    appendLine("    }")
+    appendLine("    return krapper_release(out, size);")
+    appendLine("}")
+    appendLine()
+    appendLine("void ${cls.unpackFunction}(void* thiz, const int8_t* buffer, size_t size) {")
+    countCall(cls.unpackFunction)?.let { appendLine("    $it;") }
+    appendLine("    ${cls.type}* self = reinterpret_cast<${cls.type}*>(thiz);")
+    appendLine("    const char* in = reinterpret_cast<const char*>(buffer);")
+    appendLine("    const char* end = in + size;")
+    appendLine("    self->clear();")
+    appendLine("    while (in < end) {")
+    if (container.value == null) {
+        appendLine("        std::string value;")
+        appendLine("        if (!krapper_get(in, end, value)) break;")
+        appendLine("        self->push_back(value);")
+    } else {
+        appendLine("        std::string key;")
+        appendLine("        ${container.value.wireType} value;")
+        appendLine("        if (!krapper_get(in, end, key) || !krapper_get(in, end, value)) break;")
+        appendLine("        (*self)[key] = value;")
+    }
+    appendLine("    }")
+    appendLine("}")
+}
+
+/**
+ * Kotlin side of the buffers, shared by every container and placed next to the cinterop
+ * bindings in [pkg].
+ */
+fun stringBufferKotlin(pkg: String): String = """
+package $pkg
+
+import kotlinx.cinterop.ByteVar
+import kotlinx.cinterop.CPointer
+import kotlinx.cinterop.addressOf
+import kotlinx.cinterop.convert
+import kotlinx.cinterop.usePinned
+import platform.posix.size_t
+
+class KrapperBufferWriter {
+    private var bytes = ByteArray(64)
+    private var size = 0
+
+    fun putBits(bits: Long, count: Int) {
+        ensure(count)
+        for (i in 0 until count) {
+            bytes[size++] = (bits shr (8 * i)).toByte()
+        }
+    }
+
+    fun putString(value: String) {
+        val encoded = value.encodeToByteArray()
+        putBits(encoded.size.toLong(), 4)
+        ensure(encoded.size)
+        encoded.copyInto(bytes, size)
+        size += encoded.size
+    }
+
+    fun <R> pinned(block: (CPointer<ByteVar>, size_t) -> R): R = bytes.usePinned {
+        block(it.addressOf(0), size.convert())
+    }
+
+    private fun ensure(count: Int) {
+        if (size + count > bytes.size) {
+            bytes = bytes.copyOf(maxOf(bytes.size * 2, size + count))
+        }
+    }
+}
+
+class KrapperBufferReader(private val bytes: ByteArray) {
+    private var position = 0
+
+    val hasMore: Boolean
+        get() = position < bytes.size
+
+    fun bits(count: Int): Long {
+        var result = 0L
+        for (i in 0 until count) {
+            result = result or ((bytes[position++].toLong() and 0xff) shl (8 * i))
+        }
+        return result
+    }
+
+    fun string(): String {
+        val length = bits(4).toInt()
+        return bytes.decodeToString(position, position + length).also {
+            position += length
+        }
+    }
+}
+""".trimStart()
+
+private fun BufferValue.write(value: String): String = when (kotlinType) {
+    "String" -> "putString($value)"
+    "Float", "Double" -> "putBits($value.toRawBits().toLong(), $bytes)"
+    else -> "putBits($value.toLong(), $bytes)"
+}
+
+private fun BufferValue.read(): String = when (kotlinType) {
+    "String" -> "string()"
+    "Float" -> "Float.fromBits(bits(4).toInt())"
+    "Double" -> "Double.fromBits(bits(8))"
+    "Long" -> "bits(8)"
+    else -> "bits($bytes).to$kotlinType()"
+}
+
+/**
+ * Kotlin extensions on the wrapper of [cls] converting it to and from a Kotlin collection with
+ * one native call, using the cinterop bindings in [pkg].
+ */
+fun stringContainerKotlin(cls: ResolvedClass, container: StringContainer, pkg: String): String {
+    val type = cls.type.kotlinType
+    val name = type.name.trimEnd('?')
+    val value = container.value
+    val collection = if (value == null) "List<String>" else "Map<String, ${value.kotlinType}>"
+    val builder = if (value == null) "buildList" else "buildMap"
+    val read = if (value == null) {
+        "add(reader.string())"
+    } else {
+        "put(reader.string(), reader.${value.read()})"
+    }
+    val write = if (value == null) {
+        "values.forEach(writer::putString)"
+    } else {
+        """for ((key, value) in values) {
+        writer.putString(key)
+        writer.${value.write("value")}
+    }"""
+    }
+    return """
+package ${type.pkg}
+
+import $pkg.KrapperBufferReader
+import $pkg.KrapperBufferWriter
+import $pkg.${cls.packFunction}
+import $pkg.${cls.unpackFunction}
+import kotlinx.cinterop.alloc
+import kotlinx.cinterop.memScoped
+import kotlinx.cinterop.ptr
+import kotlinx.cinterop.readBytes
+import kotlinx.cinterop.value
+import platform.posix.free
+import platform.posix.size_tVar
+
+// Bulk conversions for ${cls.type}
+
+/**
+ * Copies out the whole contents with one native call.
+ */
+fun $name.toKotlin${if (value == null) "List" else "Map"}(): $collection {
+    val thiz = ptr
+    val bytes = memScoped {
+        val size = alloc<size_tVar>()
+        val buffer = ${cls.packFunction}(thiz, size.ptr) ?: error("Failed to pack ${cls.type}")
+        try {
+            buffer.readBytes(size.value.toInt())
+        } finally {
+            free(buffer)
+        }
+    }
+    val reader = KrapperBufferReader(bytes)
+    return $builder {
+        while (reader.hasMore) {
+            $read
+        }
+    }
+}
+
+/**
+ * Replaces the contents with [values] in one native call.
+ */
+fun $name.copyFrom(values: $collection) {
+    val thiz = ptr
+    val writer = KrapperBufferWriter()
+    $write
+    writer.pinned { buffer, size ->
+        ${cls.unpackFunction}(thiz, buffer, size)
+    }
+}
+""".trimStart()
+}
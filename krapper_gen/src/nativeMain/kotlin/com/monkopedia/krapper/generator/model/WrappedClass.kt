@@ -23,6 +23,7 @@ import com.monkopedia.krapper.generator.codegen.BasicAssignmentOperator
 import com.monkopedia.krapper.generator.codegen.Operator
 import com.monkopedia.krapper.generator.includedFile
 import com.monkopedia.krapper.generator.isAbstract
+import com.monkopedia.krapper.generator.isPODType
 import com.monkopedia.krapper.generator.model.type.WrappedType
 import com.monkopedia.krapper.generator.model.type.WrappedTypeReference
 import com.monkopedia.krapper.generator.resolvedmodel.AllocationStyle.STACK
@@ -31,6 +32,7 @@ import com.monkopedia.krapper.generator.resolvedmodel.MethodType.SIZE_OF
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClassMetadata
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
 import com.monkopedia.krapper.generator.spelling
 import com.monkopedia.krapper.generator.toKString
 import com.monkopedia.krapper.generator.type
@@ -55,7 +57,9 @@ data class ClassMetadata(
     var hasConstructor: Boolean = false,
     var hasPrivateConstField: Boolean = false,
     var hasDefaultConstructor: Boolean = false,
-    var hasCopyConstructor: Boolean = false
+    var hasCopyConstructor: Boolean = false,
+    var isPlainStruct: Boolean = false,
+    var isStandardLayout: Boolean = false
 ) {
     fun toResolved(): ResolvedClassMetadata = ResolvedClassMetadata(
         hasHiddenNew = hasHiddenNew,
@@ -63,7 +67,8 @@ data class ClassMetadata(
         hasConstructor = hasConstructor,
         hasPrivateConstField = hasPrivateConstField,
         hasDefaultConstructor = hasDefaultConstructor,
-        hasCopyConstructor = hasCopyConstructor
+        hasCopyConstructor = hasCopyConstructor,
+        isPlainStruct = isPlainStruct
     )
 }
 
@@ -82,7 +87,11 @@ class WrappedClass(
     constructor(value: CValue<CXCursor>, resolverBuilder: ResolverBuilder) : this(
         wrapName(value, value.spelling.toKString() ?: error("Missing name")),
         value.isAbstract
-    )
+    ) {
+        // Narrowed down once the fields are visited and again once they are resolved.
+        metadata.isPlainStruct = value.type.isPODType
+        metadata.isStandardLayout = true
+    }
 
     override fun clone(): WrappedClass = clone(this.specifiedType)
 
@@ -96,7 +105,7 @@ class WrappedClass(
     override suspend fun resolve(resolverContext: ResolveContext): ResolvedClass? {
         val baseClasses = resolverContext.findBases(this)
         modifyMethodsIfNeeded(baseClasses)
-        return ResolvedClass(
+        val cls = ResolvedClass(
             name,
             isAbstract,
             specifiedType?.let {
@@ -121,17 +130,26 @@ class WrappedClass(
                 type,
                 "Default class type resolve"
             )
-        ).also {
-            it.addAllChildren(
-                children.toList().mapNotNull { child ->
-                    if (isAbstract && child is WrappedConstructor) {
-                        null
-                    } else {
-                        child.resolve(resolverContext + this)
-                    }
-                }
-            )
+        )
+        val resolvedChildren = children.toList().mapNotNull { child ->
+            // Enums are only generated once something references them.
+            if (isAbstract && child is WrappedConstructor || child is WrappedEnum) {
+                null
+            } else {
+                child.resolve(resolverContext + this)
+            }
+        }
+        val fields = resolvedChildren.filterIsInstance<ResolvedField>()
+        // The C struct has to match the whole layout, so every field needs to make it through.
+        val isPlainStruct = metadata.isPlainStruct && baseClass == null &&
+            fields.isNotEmpty() && fields.size == children.count { it is WrappedField } &&
+            fields.all { it.isPrimitive }
+        val resolved = if (isPlainStruct == metadata.isPlainStruct) {
+            cls
+        } else {
+            cls.copy(metadata = cls.metadata.copy(isPlainStruct = isPlainStruct))
         }
+        return resolved.also { it.addAllChildren(resolvedChildren) }
     }
 
     private fun modifyMethodsIfNeeded(baseClasses: List<WrappedClass>) {
@@ -215,6 +233,7 @@ class WrappedClass(
 
     private fun calculateNotEmpty() = baseClass != null || children.any {
         (it !is WrappedBase) &&
+            (it !is WrappedEnum) &&
             ((it as? WrappedMethod)?.methodType != SIZE_OF) &&
             ((it as? WrappedMethod)?.methodType != ALIGN_OF) &&
             ((it as? WrappedConstructor)?.children?.isNotEmpty() != false)
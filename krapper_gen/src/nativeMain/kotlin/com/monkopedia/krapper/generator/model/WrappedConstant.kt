@@ -0,0 +1,65 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.model
+
+import clang.CXCursor
+import com.monkopedia.krapper.generator.ResolveContext
+import com.monkopedia.krapper.generator.ResolverBuilder
+import com.monkopedia.krapper.generator.evaluateNumber
+import com.monkopedia.krapper.generator.model.type.WrappedType
+import com.monkopedia.krapper.generator.model.type.enumType
+import com.monkopedia.krapper.generator.model.type.isEnum
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedConstant
+import com.monkopedia.krapper.generator.spelling
+import com.monkopedia.krapper.generator.toKString
+import com.monkopedia.krapper.generator.toResolvedKotlinType
+import com.monkopedia.krapper.generator.type
+import kotlinx.cinterop.CValue
+
+/**
+ * A static const or constexpr variable with a [value] clang could fold, these are generated as
+ * Kotlin constants instead of getters.
+ */
+class WrappedConstant(val name: String, val type: WrappedType, val value: String) :
+    WrappedElement() {
+
+    constructor(cursor: CValue<CXCursor>, value: String, resolverBuilder: ResolverBuilder) : this(
+        cursor.spelling.toKString() ?: error("Constant without name"),
+        WrappedType(cursor.type, resolverBuilder),
+        value
+    )
+
+    override fun clone(): WrappedConstant = WrappedConstant(name, type, value).also {
+        it.parent = parent
+    }
+
+    override fun toString(): String = "const $name: $type = $value"
+
+    override suspend fun resolve(resolverContext: ResolveContext): ResolvedConstant? {
+        val type = type.unconst
+        if (!type.isNative && !type.isEnum) {
+            return resolverContext.notifyFailed(this, type, "Constant type")
+        }
+        val scope = when (val parent = parent) {
+            is WrappedClass -> parent.type.toString()
+            is WrappedNamespace -> parent.fullyQualified
+            else -> ""
+        }
+        // Value classes can't be const, so enum typed constants stay as their integer.
+        val kotlinType = (type.enumType?.integerType ?: type).kotlinType
+        return ResolvedConstant(name, scope, toResolvedKotlinType(kotlinType), value)
+    }
+}
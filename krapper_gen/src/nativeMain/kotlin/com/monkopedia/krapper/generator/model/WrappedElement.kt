@@ -26,10 +26,17 @@ import com.monkopedia.krapper.generator.ResolveContext
 import com.monkopedia.krapper.generator.ResolverBuilder
 import com.monkopedia.krapper.generator.accessSpecifier
 import com.monkopedia.krapper.generator.availability
+import com.monkopedia.krapper.generator.canonicalType
+import com.monkopedia.krapper.generator.evaluateNumber
 import com.monkopedia.krapper.generator.forEachRecursive
 import com.monkopedia.krapper.generator.getArgument
+import com.monkopedia.krapper.generator.isAnonymous
+import com.monkopedia.krapper.generator.isBitField
+import com.monkopedia.krapper.generator.isConstQualifiedType
 import com.monkopedia.krapper.generator.isCopyConstructor
 import com.monkopedia.krapper.generator.isDefaultConstructor
+import com.monkopedia.krapper.generator.isPODType
+import com.monkopedia.krapper.generator.isVirtual
 import com.monkopedia.krapper.generator.kind
 import com.monkopedia.krapper.generator.model.type.WrappedTemplateRef
 import com.monkopedia.krapper.generator.model.type.WrappedType
@@ -82,6 +89,14 @@ abstract class WrappedElement(
     abstract suspend fun resolve(resolverContext: ResolveContext): ResolvedElement?
 
     companion object {
+        /**
+         * Forget elements from previous parses, the lookup is only meant to merge cursors
+         * seen across the headers of a single request.
+         */
+        fun resetLookup() {
+            elementLookup.clear()
+        }
+
         fun mapAll(value: CValue<CXCursor>, resolverBuilder: ResolverBuilder): WrappedElement? {
             val element = map(value, null, null, resolverBuilder) ?: return null
             value.forEachRecursive { childCursor, parentCursor ->
@@ -110,8 +125,10 @@ abstract class WrappedElement(
 //                    )
                     return@forEachRecursive
                 }
-                if (child is WrappedMethod && parent is WrappedNamespace) {
-                    // Don't add a method to a namespace when its already been added to a class.
+                if ((child is WrappedMethod || child is WrappedConstant) &&
+                    parent is WrappedNamespace
+                ) {
+                    // Don't add a member to a namespace when its already been added to a class.
                     if (child.parent is WrappedClass) {
                         return@forEachRecursive
                     }
@@ -140,6 +157,10 @@ abstract class WrappedElement(
 
             elementLookup[strTag]?.let { return it }
 
+            if (value.kind == CXCursorKind.CXCursor_CXXBaseSpecifier || value.isVirtualMember) {
+                // Field offsets are only read directly for standard layout classes.
+                (parent as? WrappedClass)?.metadata?.isStandardLayout = false
+            }
             if (value.accessSpecifier == CX_CXXAccessSpecifier.CX_CXXPrivate ||
                 value.accessSpecifier == CX_CXXAccessSpecifier.CX_CXXProtected ||
                 value.availability == CXAvailabilityKind.CXAvailability_NotAvailable
@@ -159,6 +180,8 @@ abstract class WrappedElement(
                     }
                 }
                 if (value.kind == CXCursorKind.CXCursor_FieldDecl) {
+                    (parent as? WrappedClass)?.metadata?.isPlainStruct = false
+                    (parent as? WrappedClass)?.metadata?.isStandardLayout = false
                     if (WrappedType(value.type, resolverBuilder).isConst) {
                         (parent as? WrappedClass)?.metadata?.hasPrivateConstField = true
                         (parent as? WrappedTemplate)?.metadata?.hasPrivateConstField = true
@@ -172,9 +195,35 @@ abstract class WrappedElement(
                 CXCursorKind.CXCursor_StructDecl,
                 CXCursorKind.CXCursor_ClassDecl -> WrappedClass(value, resolverBuilder)
 
-                //                CXCursorKind.CXCursor_EnumDecl -> TODO()
-//                CXCursorKind.CXCursor_EnumConstantDecl -> TODO()
-                CXCursorKind.CXCursor_FieldDecl -> WrappedField(value, resolverBuilder)
+                CXCursorKind.CXCursor_EnumDecl -> {
+                    // Anonymous enums have no type to reference, their constants are plain ints.
+                    if (value.isAnonymous) return null
+                    WrappedEnum(value)
+                }
+
+                CXCursorKind.CXCursor_EnumConstantDecl -> WrappedEnumConstant(value)
+
+                CXCursorKind.CXCursor_FieldDecl -> WrappedField(value, resolverBuilder).also {
+                    if (value.isBitField) {
+                        (parent as? WrappedClass)?.metadata?.isPlainStruct = false
+                    }
+                    // A member that isn't standard layout (e.g. a std::map) makes the class
+                    // not standard layout either, POD is the closest check libclang offers.
+                    if (!value.type.canonicalType.isPODType) {
+                        (parent as? WrappedClass)?.metadata?.isStandardLayout = false
+                    }
+                }
+
+                CXCursorKind.CXCursor_VarDecl -> {
+                    // Only constants clang can fold are kept, they need no wrapper at runtime.
+                    if (!value.type.isConstQualifiedType) return null
+                    val constant = value.evaluateNumber() ?: return null
+                    try {
+                        WrappedConstant(value, constant, resolverBuilder)
+                    } catch (t: IllegalArgumentException) {
+                        return null
+                    }
+                }
 
                 CXCursorKind.CXCursor_ParmDecl -> return null
 
@@ -302,6 +351,16 @@ fun WrappedElement.forEachRecursive(onEach: (WrappedElement) -> Unit) {
     }
 }
 
+/**
+ * All descendants of this element in the same order as [forEachRecursive], not including itself.
+ */
+fun WrappedElement.recursiveSequence(): Sequence<WrappedElement> = sequence {
+    for (child in children.toList()) {
+        yield(child)
+        yieldAll(child.recursiveSequence())
+    }
+}
+
 fun WrappedElement.filterRecursive(
     ret: MutableList<WrappedElement> = mutableListOf(),
     onEach: (WrappedElement) -> Boolean
@@ -315,8 +374,22 @@ fun WrappedElement.filterRecursive(
     return ret
 }
 
+/**
+ * Points every child back at this element, cloning reparents the children of the original.
+ */
+fun WrappedElement.restoreParents() {
+    for (child in children) {
+        child.parent = this
+        child.restoreParents()
+    }
+}
+
 fun <T : WrappedElement> T.cloneRecursive(): T = clone().also {
     val newChildren = it.children.map { it.cloneRecursive() }
     it.clearChildren()
     it.addAllChildren(newChildren)
 } as T
+
+private val CValue<CXCursor>.isVirtualMember: Boolean
+    get() = (kind == CXCursorKind.CXCursor_CXXMethod || kind == CXCursorKind.CXCursor_Destructor) &&
+        isVirtual
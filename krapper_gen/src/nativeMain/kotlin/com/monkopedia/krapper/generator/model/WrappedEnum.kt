@@ -0,0 +1,85 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.model
+
+import clang.CXCursor
+import com.monkopedia.krapper.generator.ResolveContext
+import com.monkopedia.krapper.generator.canonicalType
+import com.monkopedia.krapper.generator.enumUnsignedValue
+import com.monkopedia.krapper.generator.enumValue
+import com.monkopedia.krapper.generator.fullyQualified
+import com.monkopedia.krapper.generator.integerType
+import com.monkopedia.krapper.generator.model.type.WrappedType
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedEnum
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedEnumConstant
+import com.monkopedia.krapper.generator.semanticParent
+import com.monkopedia.krapper.generator.spelling
+import com.monkopedia.krapper.generator.toKString
+import com.monkopedia.krapper.generator.toResolvedKotlinType
+import kotlinx.cinterop.CValue
+
+class WrappedEnum(val qualified: String, val integerType: WrappedType) : WrappedElement() {
+    val constants: List<WrappedEnumConstant>
+        get() = children.filterIsInstance<WrappedEnumConstant>()
+
+    constructor(value: CValue<CXCursor>) : this(value.fullyQualified, enumIntegerType(value))
+
+    override fun clone(): WrappedEnum = WrappedEnum(qualified, integerType).also {
+        it.addAllChildren(children)
+        it.parent = parent
+    }
+
+    override fun toString(): String = "enum $qualified : $integerType"
+
+    override suspend fun resolve(resolverContext: ResolveContext): ResolvedEnum? {
+        if (!integerType.isNative) {
+            return resolverContext.notifyFailed(this, integerType, "Enum integer type")
+        }
+        return ResolvedEnum(
+            qualified,
+            toResolvedKotlinType(enumKotlinType(qualified)).copy(isEnum = true),
+            toResolvedKotlinType(integerType.kotlinType),
+            constants.map { ResolvedEnumConstant(it.name, it.value) }
+        )
+    }
+}
+
+class WrappedEnumConstant(val name: String, val value: String) : WrappedElement() {
+
+    constructor(value: CValue<CXCursor>) : this(
+        value.spelling.toKString() ?: error("Enum constant without name"),
+        if (enumIntegerType(value.semanticParent).isUnsigned) {
+            value.enumUnsignedValue.toString()
+        } else {
+            value.enumValue.toString()
+        }
+    )
+
+    override fun clone(): WrappedEnumConstant = WrappedEnumConstant(name, value).also {
+        it.parent = parent
+    }
+
+    override fun toString(): String = "$name = $value"
+
+    override suspend fun resolve(resolverContext: ResolveContext): ResolvedEnum? = null
+}
+
+private fun enumIntegerType(value: CValue<CXCursor>): WrappedType = WrappedType(
+    value.integerType.canonicalType.spelling.toKString() ?: error("Enum without integer type")
+)
+
+private val WrappedType.isUnsigned: Boolean
+    get() = toString().startsWith("unsigned ") || toString() == "bool"
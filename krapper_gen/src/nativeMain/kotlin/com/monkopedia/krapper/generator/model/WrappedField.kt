@@ -18,7 +18,10 @@ package com.monkopedia.krapper.generator.model
 import clang.CXCursor
 import com.monkopedia.krapper.generator.ResolveContext
 import com.monkopedia.krapper.generator.ResolverBuilder
+import com.monkopedia.krapper.generator.isBitField
 import com.monkopedia.krapper.generator.model.type.WrappedType
+import com.monkopedia.krapper.generator.model.type.isView
+import com.monkopedia.krapper.generator.offsetOfField
 import com.monkopedia.krapper.generator.referenced
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedArgument
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
@@ -34,20 +37,32 @@ data class WrappedField(val name: String, val type: WrappedType) : WrappedElemen
     @Transient
     internal val other = Any()
 
+    /**
+     * Byte offset within the parent class, when clang could lay it out.
+     */
+    var offset: Long? = null
+
     constructor(field: CValue<CXCursor>, resolverBuilder: ResolverBuilder) : this(
         field.referenced.spelling.toKString() ?: error("Can't find name for $field"),
         WrappedType(field.type, resolverBuilder)
-    )
+    ) {
+        offset = field.offsetOfField.takeIf { it >= 0 && it % 8 == 0L && !field.isBitField }
+            ?.div(8)
+    }
 
     override fun clone(): WrappedElement = WrappedField(name, type).also {
         it.addAllChildren(children)
         it.parent = parent
+        it.offset = offset
     }
 
     override fun toString(): String = "$name: $type"
 
     override suspend fun resolve(resolverContext: ResolveContext): ResolvedField? =
         with(resolverContext.currentNamer) {
+            if (type.isView) {
+                return resolverContext.notifyFailed(this@WrappedField, type, "View field")
+            }
             val (mappedType, resolvedType) = resolverContext.mapAndResolve(type)
                 ?: return resolverContext.notifyFailed(this@WrappedField, type, "Field type")
             val type =
@@ -71,7 +86,7 @@ data class WrappedField(val name: String, val type: WrappedType) : WrappedElemen
                     wrappedArgType,
                     "Arg type"
                 )
-            return ResolvedField(
+            val field = ResolvedField(
                 name,
                 type.isConst,
                 ResolvedFieldGetter(
@@ -103,5 +118,32 @@ data class WrappedField(val name: String, val type: WrappedType) : WrappedElemen
                     )
                 )
             )
+            val isStandardLayout = (parent as? WrappedClass)?.metadata?.isStandardLayout == true
+            return if (isStandardLayout && !mappedType.isReference && field.isPrimitive) {
+                field.copy(offset = offset)
+            } else {
+                field
+            }
         }
 }
+
+private val primitiveTypes = setOf(
+    "kotlin.Boolean",
+    "kotlin.Byte",
+    "kotlin.UByte",
+    "kotlin.Short",
+    "kotlin.UShort",
+    "kotlin.Int",
+    "kotlin.UInt",
+    "kotlin.Long",
+    "kotlin.ULong",
+    "kotlin.Float",
+    "kotlin.Double"
+)
+
+/**
+ * Whether this field holds a value Kotlin can read straight out of memory.
+ */
+val ResolvedField.isPrimitive: Boolean
+    get() = kotlinType.fullyQualified in primitiveTypes &&
+        getter.returnType.cType.type != "long double"
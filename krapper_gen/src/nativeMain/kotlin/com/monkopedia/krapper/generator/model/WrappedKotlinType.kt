@@ -21,6 +21,10 @@ import com.monkopedia.krapper.generator.builders.KotlinFactory.Companion.C_VALUE
 import com.monkopedia.krapper.generator.model.type.WrappedTemplateRef
 import com.monkopedia.krapper.generator.model.type.WrappedTemplateType
 import com.monkopedia.krapper.generator.model.type.WrappedType
+import com.monkopedia.krapper.generator.model.type.enumType
+import com.monkopedia.krapper.generator.model.type.isEnum
+import com.monkopedia.krapper.generator.model.type.isEnumValue
+import com.monkopedia.krapper.generator.model.type.viewType
 
 interface WrappedKotlinType {
     val isWrapper: Boolean
@@ -86,6 +90,7 @@ private val pointerTypeMap = mapOf(
 fun typeToKotlinType(type: WrappedType): WrappedKotlinType = WrappedKotlinType(type)
 
 fun WrappedKotlinType(type: WrappedType): WrappedKotlinType {
+    type.viewType?.let { return fullyQualifiedType(it.kotlinType) }
     if (type is WrappedTemplateType) {
         return WrappedKotlinType(
             WrappedKotlinType(type.baseType).pkg + "." +
@@ -101,6 +106,8 @@ fun WrappedKotlinType(type: WrappedType): WrappedKotlinType {
         )
     }
     if (type is WrappedTemplateRef) throw IllegalArgumentException("Can't convert $type to kotlin")
+    if (type.isEnumValue) return enumKotlinType(type.enumType!!.name)
+    if (type.isEnum) return WrappedKotlinType(type.cType)
     if (type.isString) return fullyQualifiedType("kotlin.String?")
     if (type.toString() == "const char*") return fullyQualifiedType("kotlin.String?")
     if (type.isConst) {
@@ -186,6 +193,13 @@ internal class NullableKotlinType(internal val base: WrappedKotlinType) : Wrappe
 
 fun nullable(base: WrappedKotlinType): WrappedKotlinType = NullableKotlinType(base)
 
+/**
+ * The value class generated for the enum [qualified], top level enums going in the root package.
+ */
+fun enumKotlinType(qualified: String): WrappedKotlinType = fullyQualifiedType(
+    qualified.split("::").let { if (it.size == 1) listOf("root") + it else it }.joinToString(".")
+)
+
 fun WrappedKotlinType(nameIn: String): WrappedKotlinType {
     val name = nameIn.trim()
     if (name.contains("<")) {
@@ -31,6 +31,8 @@ import com.monkopedia.krapper.generator.model.type.WrappedType.Companion.LONG_DO
 import com.monkopedia.krapper.generator.model.type.WrappedType.Companion.VOID
 import com.monkopedia.krapper.generator.model.type.WrappedType.Companion.const
 import com.monkopedia.krapper.generator.model.type.WrappedType.Companion.pointerTo
+import com.monkopedia.krapper.generator.model.type.isEnum
+import com.monkopedia.krapper.generator.model.type.isView
 import com.monkopedia.krapper.generator.referenced
 import com.monkopedia.krapper.generator.resolvedmodel.AllocationStyle
 import com.monkopedia.krapper.generator.resolvedmodel.AllocationStyle.DIRECT
@@ -303,6 +305,13 @@ open class WrappedMethod(
 
     override suspend fun resolve(resolverContext: ResolveContext): ResolvedMethod? =
         with(resolverContext.currentNamer) {
+            if (returnType.isView) {
+                return resolverContext.notifyFailed(
+                    this@WrappedMethod,
+                    returnType,
+                    "Views can't outlive the call, so can't be returned"
+                )
+            }
             val (rawMapping, rawResolved) = resolverContext.mapAndResolve(returnType)
                 ?: return resolverContext.notifyFailed(
                     this@WrappedMethod,
@@ -427,7 +436,8 @@ class WrappedArgument(
         val (type, resolved) =
             resolverContext.mapAndResolve(unreferencedType)
                 ?: return resolverContext.notifyFailed(this, unreferencedType, "Missing type $type")
-        val needsDereference = !type.isPointer && !type.isNative && type != LONG_DOUBLE
+        val needsDereference =
+            !type.isView && !type.isPointer && !type.isNative && type != LONG_DOUBLE
         val resolvedArgType =
             if (needsDereference) {
                 val pointerType = pointerTo(type)
@@ -468,8 +478,12 @@ fun determineArgumentCastMode(
     isReference: Boolean,
     resolverContext: ResolveContext
 ) = when {
+    type.isView -> ArgumentCastMode.VIEW
+
     type.isString -> ArgumentCastMode.STRING
 
+    type.isEnum -> RAW_CAST
+
     type.isNative -> NATIVE
 
     type == LONG_DOUBLE -> RAW_CAST
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.model.type
+
+/**
+ * Reference to an enum, which wrappers pass around as its [integerType].
+ */
+data class WrappedEnumType(val name: String, val integerType: WrappedType) : WrappedType() {
+    override val cType: WrappedType
+        get() = integerType
+
+    override val isReturnable: Boolean
+        get() = true
+    override val isNative: Boolean
+        get() = integerType.isNative
+    override val isString: Boolean
+        get() = false
+
+    override val isVoid: Boolean
+        get() = false
+
+    override val pointed: WrappedType
+        get() = error("Cannot get pointee of non-pointer enum $this")
+    override val isPointer: Boolean
+        get() = false
+
+    override val isArray: Boolean
+        get() = false
+
+    override val unreferenced: WrappedType
+        get() = error("Cannot get unreference of non-reference enum $this")
+
+    override val isReference: Boolean
+        get() = false
+    override val isConst: Boolean
+        get() = false
+    override val unconst: WrappedType
+        get() = this
+
+    override fun toString(): String = name
+}
+
+/**
+ * The enum this type refers to, possibly behind const or a pointer/reference.
+ */
+val WrappedType.enumType: WrappedEnumType?
+    get() = when (this) {
+        is WrappedEnumType -> this
+        is WrappedModifiedType -> baseType.enumType
+        is WrappedPrefixedType -> baseType.enumType
+        else -> null
+    }
+
+/**
+ * Enums need an explicit cast to and from their integer type.
+ */
+val WrappedType.isEnum: Boolean
+    get() = enumType != null
+
+/**
+ * An enum held by value, possibly const, which Kotlin sees as the enum's value class rather than
+ * a pointer to its integer.
+ */
+val WrappedType.isEnumValue: Boolean
+    get() = when (this) {
+        is WrappedEnumType -> true
+        is WrappedPrefixedType -> modifier == "const" && baseType.isEnumValue
+        else -> false
+    }
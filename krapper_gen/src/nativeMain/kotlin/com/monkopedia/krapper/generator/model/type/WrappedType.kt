@@ -17,6 +17,7 @@ package com.monkopedia.krapper.generator.model.type
 
 import clang.CXCursorKind.CXCursor_ClassDecl
 import clang.CXCursorKind.CXCursor_ClassTemplate
+import clang.CXCursorKind.CXCursor_EnumDecl
 import clang.CXCursorKind.CXCursor_NoDeclFound
 import clang.CXCursorKind.CXCursor_StructDecl
 import clang.CXCursorKind.CXCursor_TemplateTypeParameter
@@ -29,6 +30,8 @@ import com.monkopedia.krapper.generator.ResolveContext
 import com.monkopedia.krapper.generator.ResolverBuilder
 import com.monkopedia.krapper.generator.fullyQualified
 import com.monkopedia.krapper.generator.getTemplateArgumentType
+import com.monkopedia.krapper.generator.integerType
+import com.monkopedia.krapper.generator.isAnonymous
 import com.monkopedia.krapper.generator.isConstQualifiedType
 import com.monkopedia.krapper.generator.kind
 import com.monkopedia.krapper.generator.model.WrappedElement
@@ -220,6 +223,18 @@ abstract class WrappedType : WrappedElement() {
                     invoke(referencedDecl.fullyQualified)
                 }
 
+                referencedDecl.kind == CXCursor_EnumDecl -> {
+                    val integerType = invoke(
+                        referencedDecl.integerType.canonicalType.spelling.toKString()
+                            ?: error("Enum without integer type")
+                    )
+                    if (referencedDecl.isAnonymous) {
+                        integerType
+                    } else {
+                        WrappedEnumType(referencedDecl.fullyQualified, integerType)
+                    }
+                }
+
                 type.useContents { kind } == CXType_Unexposed &&
                     referencedDecl.kind == CXCursor_NoDeclFound &&
                     !spelling.startsWith("typename ") -> {
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator.model.type
+
+/**
+ * A `std::string_view` or `std::span<const T>` parameter, passed across C as a pointer and a
+ * length so the caller's memory is borrowed rather than copied into a wrapper object.
+ */
+data class ViewType(
+    val cppType: String,
+    val element: String,
+    val cElement: String,
+    val kotlinType: String
+) {
+    val isString: Boolean
+        get() = kotlinType == STRING
+}
+
+private const val STRING = "kotlin.String"
+private const val STD = "std::(?:__\\w+::)?"
+private val STRING_VIEW =
+    Regex("${STD}(?:string_view|basic_string_view<char(?:, ${STD}char_traits<char>)?\\s*>)")
+private val SPAN = Regex("${STD}span<const ([\\w ]+?)(?:, [^<>]+)?\\s*>")
+
+private val spanElements = mapOf(
+    "char" to ("int8_t" to "kotlin.ByteArray"),
+    "signed char" to ("int8_t" to "kotlin.ByteArray"),
+    "int8_t" to ("int8_t" to "kotlin.ByteArray"),
+    "short" to ("short" to "kotlin.ShortArray"),
+    "int16_t" to ("short" to "kotlin.ShortArray"),
+    "int" to ("int" to "kotlin.IntArray"),
+    "int32_t" to ("int" to "kotlin.IntArray"),
+    "long" to ("long" to "kotlin.LongArray"),
+    "long long" to ("long long" to "kotlin.LongArray"),
+    "int64_t" to ("int64_t" to "kotlin.LongArray"),
+    "float" to ("float" to "kotlin.FloatArray"),
+    "double" to ("double" to "kotlin.DoubleArray")
+)
+
+/**
+ * Finds the view behind a type spelling taken by value or by `const &`. The wrapper builds a
+ * temporary view from the pointer and length, which a non-const reference can't bind to.
+ */
+fun viewType(type: String): ViewType? {
+    val spelling = type.trim()
+    val unreferenced = spelling.removeSuffix("&").trim()
+    val base = unreferenced.removePrefix("const ").removeSuffix(" const").trim()
+    if (unreferenced != spelling && base == unreferenced) return null
+    if (!base.startsWith("std::")) return null
+    if (STRING_VIEW.matches(base)) return ViewType(base, "char", "int8_t", STRING)
+    val element = SPAN.matchEntire(base)?.groupValues?.get(1) ?: return null
+    val (cElement, kotlinType) = spanElements[element] ?: return null
+    return ViewType(base, element, cElement, kotlinType)
+}
+
+val WrappedType.viewType: ViewType?
+    get() = if (isPointer || isArray) null else viewType(toString())
+
+val WrappedType.isView: Boolean
+    get() = viewType != null
@@ -15,21 +15,30 @@
  */
 package com.monkopedia.krapper.generator
 
+import com.monkopedia.krapper.CallInstrumentation
 import com.monkopedia.krapper.ReferencePolicy.INCLUDE_MISSING
+import com.monkopedia.krapper.generator.builders.CodeStringBuilder
 import com.monkopedia.krapper.generator.builders.CppCodeBuilder
+import com.monkopedia.krapper.generator.builders.KotlinCodeBuilder
+import com.monkopedia.krapper.generator.builders.LocalVar
+import com.monkopedia.krapper.generator.codegen.CppCompiler
 import com.monkopedia.krapper.generator.codegen.CppWriter
 import com.monkopedia.krapper.generator.codegen.File
+import com.monkopedia.krapper.generator.codegen.HeaderWriter
+import com.monkopedia.krapper.generator.codegen.KotlinWriter
 import com.monkopedia.krapper.generator.model.WrappedClass
 import com.monkopedia.krapper.generator.model.WrappedElement
 import com.monkopedia.krapper.generator.model.WrappedField
 import com.monkopedia.krapper.generator.model.WrappedMethod
 import com.monkopedia.krapper.generator.model.WrappedTemplate
 import com.monkopedia.krapper.generator.model.type.WrappedTemplateType
+import com.monkopedia.krapper.generator.resolvedmodel.MethodType
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedField
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
 import kotlin.test.Test
+import kotlin.test.assertTrue
 import kotlin.test.fail
 import kotlinx.coroutines.runBlocking
 
@@ -1331,6 +1340,185 @@ class CppCodeTests {
         assertCode(empty, code.toString())
     }
 
+    @Test
+    fun testInstrumentedCalls(): Unit = runBlocking {
+        val code = codeBuilder()
+        val writer = CppWriter(file, code, instrumentation = CallInstrumentation.TIME)
+        val rcls = TestData.otherClass.cls.resolve(resolveContext())
+            ?: error("Resolve failed for ${TestData.otherClass.cls}")
+        writer.generate("desiredWrapper", emptyList(), listOf(rcls))
+        val generated = code.toString()
+
+        assertTrue(generated.contains("KrapperCallTimer krapper_timer(0);"))
+        assertTrue(generated.contains("    \"TestLib_OtherClass_new\",\n"))
+        assertTrue(generated.contains("void desired_wrapper_dump_stats(void) {"))
+        assertTrue(generated.contains("getenv(\"KRAPPER_CALL_STATS\")"))
+    }
+
+    @Test
+    fun testStringVectorBuffers(): Unit = runBlocking {
+        val code = codeBuilder()
+        val writer = cppWriter(code)
+        val (rcls, _) = resolveType(TestData.vector.cls, TestData.vector.constructor)
+        writer.generate("desiredWrapper", emptyList(), listOf(rcls))
+        val generated = code.toString()
+
+        assertTrue(generated.contains("#include <cstring>"))
+        assertTrue(
+            generated.contains(
+                "bool krapper_get(const char*& in, const char* end, std::string& value) {"
+            )
+        )
+        assertTrue(
+            generated.contains(
+                "int8_t* std_vector_std_string__krapper_pack(void* thiz, size_t* size) {"
+            )
+        )
+        assertTrue(generated.contains("        if (!krapper_get(in, end, value)) break;"))
+        assertTrue(generated.contains("        self->push_back(value);"))
+    }
+
+    @Test
+    fun testViewArguments(): Unit = runBlocking {
+        val cls = resolveSource(
+            """
+            #include <span>
+            #include <string_view>
+            namespace Views {
+            class Buffer {
+            public:
+                Buffer(std::string_view name, std::span<const int> values);
+                int write(std::string_view name, std::span<const int> values);
+                static int count(std::string_view name, std::span<const int> values);
+            };
+            }
+            """.trimIndent(),
+            "c++20",
+            generateIncludes("clang++")
+        ).classesByType.getValue("Views::Buffer")
+        val methods = cls.children.filterIsInstance<ResolvedMethod>()
+        val targets = listOf(
+            methods.single { it.methodType == MethodType.CONSTRUCTOR },
+            methods.single { it.name == "write" },
+            methods.single { it.name == "count" }
+        )
+        for (method in targets) {
+            val code = codeBuilder()
+            with(cppWriter(code)) {
+                code.onGenerate(cls, method)
+            }
+            val cpp = code.toString()
+            assertTrue("size_t name_size" in cpp, cpp)
+            assertTrue("size_t values_size" in cpp, cpp)
+            assertTrue("(const char*)name, name_size)" in cpp, cpp)
+            assertTrue("(values, values_size)" in cpp, cpp)
+
+            val kotlinCode = KotlinCodeBuilder()
+            with(KotlinWriter("")) {
+                kotlinCode.onGenerate(cls, method, testVar("size"), testVar("align"))
+            }
+            val kotlin = kotlinCode.toString()
+            assertTrue("nameBytes.takeIf { it.isNotEmpty() }?.refTo(0)" in kotlin, kotlin)
+            assertTrue("nameBytes.size.convert()" in kotlin, kotlin)
+            assertTrue("values.takeIf { it.isNotEmpty() }?.refTo(0)" in kotlin, kotlin)
+            assertTrue("values.size.convert()" in kotlin, kotlin)
+        }
+    }
+
+    @Test
+    fun testCompileGenerated(): Unit = runBlocking {
+        // Enums, field offsets, iteration and views only show their mistakes to a compiler.
+        val header = tempHeader(
+            """
+            #include <span>
+            #include <string_view>
+            namespace Compiled {
+            enum class Mode : unsigned char { Off, On, Auto = 7 };
+            struct Point {
+                int x;
+                double y;
+            };
+            class Stats {
+            public:
+                Stats();
+                int count;
+                double total;
+            };
+            class Hidden {
+            public:
+                int shown;
+            private:
+                int hidden;
+            };
+            class Mixed {
+            public:
+                Mixed();
+                int first;
+                Hidden member;
+                double last;
+            };
+            class Bag {
+            public:
+                int* begin();
+                int* end();
+            };
+            class Buffer {
+            public:
+                Buffer();
+                Mode mode();
+                void setMode(Mode mode);
+                int write(std::string_view name, std::span<const int> values);
+            };
+            }
+            """.trimIndent()
+        )
+        val classes = resolveHeader(header, "c++20", generateIncludes("clang++"))
+        val outputDir = File(header.removeSuffix(".hh"))
+        outputDir.mkdirs()
+        File(outputDir, "wrapper.h").writeText(
+            CppCodeBuilder().also {
+                HeaderWriter(it).generate("wrapper", listOf(header), classes)
+            }.toString()
+        )
+        val cppFile = File(outputDir, "wrapper.cc")
+        cppFile.writeText(
+            CppCodeBuilder().also {
+                CppWriter(cppFile, it).generate("wrapper", listOf(header), classes)
+            }.toString()
+        )
+        try {
+            CppCompiler(File(outputDir, "wrapper.o"), "clang++", "c++20")
+                .compile(cppFile, listOf(header), emptyList())
+        } finally {
+            outputDir.rmR()
+        }
+    }
+
+    private fun testVar(varName: String) = object : LocalVar {
+        override val name: String
+            get() = varName
+
+        override fun build(builder: CodeStringBuilder) {
+            builder.append(varName)
+        }
+    }
+
+    @Test
+    fun testProbedCalls(): Unit = runBlocking {
+        val code = codeBuilder()
+        val writer = CppWriter(file, code, instrumentation = CallInstrumentation.PROBES)
+        val rcls = TestData.otherClass.cls.resolve(resolveContext())
+            ?: error("Resolve failed for ${TestData.otherClass.cls}")
+        writer.generate("desiredWrapper", emptyList(), listOf(rcls))
+        val generated = code.toString()
+
+        assertTrue(
+            generated.contains("KrapperProbeScope krapper_probe(\"TestLib_OtherClass_new\");")
+        )
+        assertTrue(generated.contains("DTRACE_PROBE1(desired_wrapper, call__entry, symbol);"))
+        assertTrue(!generated.contains("desired_wrapper_dump_stats"))
+    }
+
     private fun runTest(cls: WrappedClass, target: WrappedMethod, expected: String): Unit =
         runBlocking {
             assertCode(expected, buildCode(cls, target).toString())
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.MapRequest
+import com.monkopedia.krapper.RemoveChild
+import com.monkopedia.krapper.RemoveParent
+import com.monkopedia.krapper.ReplaceChild
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedNamespace
+import com.monkopedia.krapper.generator.resolvedmodel.recursiveSequence
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertTrue
+
+class ElementPositionsTest {
+
+    private val root = ResolvedNamespace("root").also { root ->
+        for (i in 0 until 5) {
+            root.addChild(
+                ResolvedNamespace("child$i").also { child ->
+                    child.addChild(ResolvedNamespace("grandchild$i"))
+                }
+            )
+        }
+    }
+    private val children = root.children.toList()
+    private val positions = ElementPositions(listOf(root).recursiveSequence().toList())
+
+    private fun names(element: ResolvedElement) =
+        element.children.map { (it as ResolvedNamespace).namespace }
+
+    @Test
+    fun testReplaceKeepsPosition() {
+        val replacement = ResolvedNamespace("replacement")
+        positions.apply(ReplaceChild(replacement), children[2])
+
+        assertEquals(listOf("child0", "child1", "replacement", "child3", "child4"), names(root))
+        assertEquals(MapRequest(root, 2), positions.request(replacement))
+        assertEquals(MapRequest(root, 3), positions.request(children[3]))
+    }
+
+    @Test
+    fun testRemoveSiblings() {
+        for (i in 1..3) {
+            positions.apply(RemoveChild, children[i])
+        }
+
+        assertEquals(listOf("child0", "child4"), names(root))
+        assertEquals(MapRequest(root, 0), positions.request(children[0]))
+        assertEquals(MapRequest(root, 1), positions.request(children[4]))
+    }
+
+    @Test
+    fun testDetachedElementsSkipped() {
+        val grandchild = children[1].children.single()
+        positions.apply(RemoveParent, grandchild)
+        positions.apply(ReplaceChild(ResolvedNamespace("replacement")), children[3])
+
+        assertFalse(positions.isAttached(children[1]))
+        assertFalse(positions.isAttached(grandchild))
+        assertFalse(positions.isAttached(children[3].children.single()))
+        assertTrue(positions.isAttached(children[4]))
+        assertEquals(MapRequest(root, 3), positions.request(children[4]))
+    }
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.filter
+import com.monkopedia.krapper.generator.model.MethodType
+import com.monkopedia.krapper.generator.model.WrappedClass
+import com.monkopedia.krapper.generator.model.WrappedElement
+import com.monkopedia.krapper.generator.model.WrappedMethod
+import com.monkopedia.krapper.generator.model.WrappedNamespace
+import com.monkopedia.krapper.generator.model.WrappedTU
+import com.monkopedia.krapper.generator.model.recursiveSequence
+import com.monkopedia.krapper.generator.model.type.WrappedType
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+class FilterPlanTest {
+
+    private val tu = WrappedTU().also { tu ->
+        tu.addChild(
+            WrappedNamespace("v8").also { v8 ->
+                v8.addChild(
+                    WrappedClass("Isolate").also {
+                        it.addChild(
+                            WrappedMethod("Dispose", WrappedType("void"), MethodType.METHOD)
+                        )
+                    }
+                )
+                v8.addChild(WrappedClass("Context"))
+            }
+        )
+        tu.addChild(
+            WrappedNamespace("std").also { std ->
+                std.addChild(WrappedClass("string"))
+            }
+        )
+    }
+
+    private val index = FilterIndex(WrappedFilterModel, tu.recursiveSequence())
+
+    private fun names(elements: List<WrappedElement>) = elements.map { it.toString() }
+
+    @Test
+    fun testIndexedPrefix() {
+        val plan = filter {
+            (thiz isType ResolvedClass) and (qualified startsWith "v8::")
+        }.wrapperFilter().bind(index)
+
+        assertEquals(listOf("v8::Isolate", "v8::Context"), names(plan.candidates()!!))
+        assertEquals(listOf("v8::Isolate", "v8::Context"), names(index.elements.filter(plan)))
+    }
+
+    @Test
+    fun testIndexedMatchesUnbound() {
+        val definition = filter {
+            (qualified eq "std::string") or (qualified startsWith "v8::I")
+        }
+        val bound = definition.wrapperFilter().bind(index)
+        val unbound = definition.wrapperFilter()
+
+        assertEquals(names(index.elements.filter(unbound)), names(index.elements.filter(bound)))
+        assertEquals(listOf("v8::Isolate", "std::string"), names(bound.candidates()!!))
+        assertNull(unbound.candidates())
+    }
+
+    @Test
+    fun testInvalidateAfterMutation() {
+        val plan = filter {
+            (thiz isType ResolvedClass) and (qualified startsWith "std::")
+        }.wrapperFilter().bind(index)
+        assertEquals(listOf("std::string"), names(plan.candidates()!!))
+
+        val context = index.elements.first { it.toString() == "v8::Context" }
+        context.parent = index.elements.first { (it as? WrappedNamespace)?.namespace == "std" }
+        plan.invalidate()
+
+        assertEquals(listOf("std::Context", "std::string"), names(plan.candidates()!!))
+        assertTrue(plan(context))
+    }
+
+    @Test
+    fun testUpdateOnlyTouched() {
+        val std = filter {
+            (thiz isType ResolvedClass) and (qualified startsWith "std::")
+        }.wrapperFilter().bind(index)
+        val v8 = filter {
+            (thiz isType ResolvedClass) and (qualified startsWith "v8::")
+        }.wrapperFilter().bind(index)
+        val context = index.elements.first { it.toString() == "v8::Context" }
+        assertTrue(v8(context))
+        assertEquals(listOf("std::string"), names(std.candidates()!!))
+
+        val stdNamespace = index.elements.first { (it as? WrappedNamespace)?.namespace == "std" }
+        context.parent = stdNamespace
+        val affected = index.update(listOf(stdNamespace, context))
+        std.invalidate(affected)
+        v8.invalidate(affected)
+
+        assertTrue(std(context))
+        assertFalse(v8(context))
+        assertEquals(listOf("std::Context", "std::string"), names(std.candidates()!!))
+        assertEquals(listOf("v8::Isolate"), names(v8.candidates()!!))
+        assertFalse(names(affected).contains("v8::Isolate"))
+    }
+
+    @Test
+    fun testRegexAndHierarchy() {
+        val plan = filter {
+            (thiz isType ResolvedMethod) and parent(qualified regex "v8::[A-Z][a-z]+")
+        }.wrapperFilter().bind(index)
+
+        assertNull(plan.candidates())
+        assertEquals(
+            listOf("Dispose"),
+            index.elements.filter(plan).map { (it as WrappedMethod).name }
+        )
+    }
+}
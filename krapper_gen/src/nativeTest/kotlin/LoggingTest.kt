@@ -0,0 +1,99 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.RemoteLogger
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlinx.coroutines.runBlocking
+
+class LoggingTest {
+
+    private class RecordingLogger : RemoteLogger {
+        val messages = mutableListOf<Pair<LogLevel, String>>()
+
+        override suspend fun e(message: String) {
+            messages.add(LogLevel.ERROR to message)
+        }
+
+        override suspend fun i(message: String) {
+            messages.add(LogLevel.INFO to message)
+        }
+
+        override suspend fun w(message: String) {
+            messages.add(LogLevel.WARN to message)
+        }
+    }
+
+    @Test
+    fun testLevelSkipsLambda(): Unit = runBlocking {
+        val previous = Log.level
+        Log.level = LogLevel.WARN
+        try {
+            var built = false
+            Log.d {
+                built = true
+                "debug"
+            }
+            Log.i {
+                built = true
+                "info"
+            }
+            assertFalse(built)
+        } finally {
+            Log.level = previous
+        }
+    }
+
+    @Test
+    fun testBatchesUpToMax(): Unit = runBlocking {
+        val target = RecordingLogger()
+        val logger = BufferedLogger(target, this, maxBatch = 3)
+        for (i in 1..5) {
+            logger.i("m$i")
+        }
+        logger.flush()
+        logger.close()
+
+        assertEquals(
+            listOf(LogLevel.INFO to "m1\nm2\nm3", LogLevel.INFO to "m4\nm5"),
+            target.messages
+        )
+    }
+
+    @Test
+    fun testFlushDeliversEverything(): Unit = runBlocking {
+        val target = RecordingLogger()
+        val logger = BufferedLogger(target, this)
+        logger.i("a")
+        logger.w("b")
+        logger.e("c")
+        logger.i("d")
+        logger.flush()
+
+        assertEquals(
+            listOf(
+                LogLevel.INFO to "a",
+                LogLevel.WARN to "b",
+                LogLevel.ERROR to "c",
+                LogLevel.INFO to "d"
+            ),
+            target.messages
+        )
+        logger.close()
+    }
+}
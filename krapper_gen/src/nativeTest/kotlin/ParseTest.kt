@@ -17,19 +17,45 @@ package com.monkopedia.krapper.generator
 
 import com.monkopedia.krapper.ReferencePolicy
 import com.monkopedia.krapper.generator.codegen.File
+import com.monkopedia.krapper.generator.codegen.SmartPointer
+import com.monkopedia.krapper.generator.codegen.StringContainer
+import com.monkopedia.krapper.generator.codegen.VectorElement
+import com.monkopedia.krapper.generator.codegen.enumConstantsKotlin
+import com.monkopedia.krapper.generator.codegen.fieldOffsetAssertions
+import com.monkopedia.krapper.generator.codegen.isIterable
+import com.monkopedia.krapper.generator.codegen.iterationDeclarations
+import com.monkopedia.krapper.generator.codegen.iterationFunctions
+import com.monkopedia.krapper.generator.codegen.kotlinConstVal
+import com.monkopedia.krapper.generator.codegen.plainStructAssertions
+import com.monkopedia.krapper.generator.codegen.plainStructDeclaration
+import com.monkopedia.krapper.generator.codegen.smartPointer
+import com.monkopedia.krapper.generator.codegen.snapshotDeclarations
+import com.monkopedia.krapper.generator.codegen.snapshotFields
+import com.monkopedia.krapper.generator.codegen.snapshotFunctions
+import com.monkopedia.krapper.generator.codegen.snapshotKotlin
+import com.monkopedia.krapper.generator.codegen.stringContainer
+import com.monkopedia.krapper.generator.codegen.structFields
+import com.monkopedia.krapper.generator.codegen.vectorElement
 import com.monkopedia.krapper.generator.model.WrappedClass
 import com.monkopedia.krapper.generator.model.WrappedElement
 import com.monkopedia.krapper.generator.model.WrappedTemplate
 import com.monkopedia.krapper.generator.model.findQualifiers
+import com.monkopedia.krapper.generator.model.type.ViewType
 import com.monkopedia.krapper.generator.model.type.WrappedType
+import com.monkopedia.krapper.generator.model.type.viewType
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedConstant
 import com.monkopedia.krapper.generator.resolvedmodel.ResolvedConstructor
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedEnum
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedMethod
 import kotlin.test.Test
 import kotlin.test.assertEquals
+import kotlin.test.assertFalse
 import kotlin.test.assertTrue
 import kotlinx.cinterop.memScoped
 import kotlinx.coroutines.runBlocking
 import platform.posix.random
+import platform.posix.usleep
 
 class ParseTest {
 //    @Test
@@ -56,6 +82,36 @@ class ParseTest {
         }
     }
 
+    @Test
+    fun testResolutionReport(): Unit = runBlocking {
+        val resolver = ParsedResolver(TestData.tu)
+        val stats = ResolutionStats()
+        val resolved = resolver.findClasses(WrappedElement::defaultFilter)
+            .resolveAll(resolver, ReferencePolicy.INCLUDE_MISSING, stats)
+        val report = stats.toReport(
+            resolved.filterIsInstance<ResolvedClass>().map { it.type.toString() }
+        )
+
+        assertTrue(report.resolved.any { it.type == "TestLib::TestClass" })
+        assertTrue(report.resolved.all { it.timeUs >= 0 })
+        assertTrue(report.typeMappingCache.hits + report.typeMappingCache.misses > 0)
+    }
+
+    @Test
+    fun testResolutionStatsAccumulate() {
+        val stats = ResolutionStats()
+        stats.recordTime("A", stats.mark())
+        stats.timeClass("A") { usleep(1000u) }
+        stats.timeClass("A") { usleep(1000u) }
+        stats.dropped(null, null, "Missing type")
+        stats.dropped(null, null, "Missing type")
+        stats.dropped(null, null, "Empty class")
+        val report = stats.toReport(listOf("A"))
+
+        assertTrue(report.resolved.single().timeUs >= 2000)
+        assertEquals(listOf("Missing type", "Empty class"), report.dropped.map { it.reason })
+    }
+
     @Test
     fun testTemplate() = memScoped {
         runBlocking {
@@ -76,6 +132,256 @@ class ParseTest {
         }
     }
 
+    @Test
+    fun testEnums(): Unit = runBlocking {
+        val resolved = resolveSource(
+            """
+            namespace TestLib {
+            enum class Mode : unsigned char { Off, On, Auto = 7 };
+            enum Unused { kUnused };
+            class Switch {
+            public:
+                Mode mode();
+                void setMode(Mode mode);
+            };
+            }
+            """.trimIndent()
+        )
+
+        val enum = resolved.filterIsInstance<ResolvedEnum>().single()
+        assertEquals("TestLib::Mode", enum.qualified)
+        assertEquals(listOf("Off = 0", "On = 1", "Auto = 7"), enum.constants.map { "$it" })
+        val kotlin = enumConstantsKotlin(enum)
+        assertTrue(kotlin.contains("value class Mode(val value: kotlin.UByte) {"))
+        assertTrue(kotlin.contains("        val Auto = Mode(7u)"))
+
+        val switch = resolved.filterIsInstance<ResolvedClass>()
+            .single { it.type.toString() == "TestLib::Switch" }
+        val methods = switch.children.filterIsInstance<ResolvedMethod>().associateBy { it.name }
+        val mode = methods.getValue("mode").returnType.kotlinType
+        assertEquals("testLib.Mode", mode.fullyQualified)
+        assertTrue(mode.isEnum)
+        assertEquals(mode, methods.getValue("setMode").args.last().type.kotlinType)
+    }
+
+    @Test
+    fun testConstants(): Unit = runBlocking {
+        val resolved = resolveSource(
+            """
+            namespace TestLib {
+            constexpr int kNamespaceSize = 8;
+            class Limits {
+            public:
+                static const int kMax = 1 << 10;
+                static const long kMin = -3;
+                static constexpr double kRatio = 0.5;
+                static int counter;
+                void touch();
+            };
+            void reset();
+            }
+            """.trimIndent()
+        )
+
+        val namespaceConstant = resolved.filterIsInstance<ResolvedConstant>().single()
+        assertEquals("TestLib", namespaceConstant.scope)
+        assertEquals(
+            "const val kNamespaceSize: Int = 8",
+            kotlinConstVal(
+                namespaceConstant.name,
+                namespaceConstant.kotlinType,
+                namespaceConstant.value
+            )
+        )
+        val cls = resolved.filterIsInstance<ResolvedClass>().single()
+        assertEquals(
+            listOf(
+                "const val kMax: Int = 1024",
+                "const val kMin: Long = -3L",
+                "const val kRatio: Double = 0.5"
+            ),
+            cls.children.filterIsInstance<ResolvedConstant>().map {
+                kotlinConstVal(it.name, it.kotlinType, it.value)
+            }
+        )
+    }
+
+    @Test
+    fun testPlainStruct(): Unit = runBlocking {
+        val classes = resolveSource(
+            """
+            namespace TestLib {
+            struct Point {
+                int x;
+                double y;
+                bool visible;
+            };
+            class Handle {
+                int hidden;
+            public:
+                int shown;
+                void touch();
+            };
+            }
+            """.trimIndent()
+        ).classesByType
+
+        val point = classes["TestLib::Point"] ?: error("Point not resolved")
+        assertTrue(point.metadata.isPlainStruct)
+        assertEquals(
+            "typedef struct TestLib_Point_Struct {\n" +
+                "    int x;\n" +
+                "    double y;\n" +
+                "    bool visible;\n" +
+                "} TestLib_Point_Struct",
+            plainStructDeclaration(point)
+        )
+        assertEquals(4, plainStructAssertions(point).size)
+        val handle = classes["TestLib::Handle"] ?: error("Handle not resolved")
+        assertTrue(!handle.metadata.isPlainStruct)
+    }
+
+    @Test
+    fun testFieldOffsets(): Unit = runBlocking {
+        val classes = resolveSource(
+            """
+            namespace TestLib {
+            class Stats {
+            public:
+                Stats();
+                ~Stats();
+                int count;
+                double total;
+                int* samples;
+            };
+            class Shape {
+            public:
+                virtual ~Shape();
+                int sides;
+            };
+            class Hidden {
+            public:
+                int shown;
+            private:
+                int hidden;
+            };
+            class Mixed {
+            public:
+                int first;
+                Hidden member;
+                double last;
+            };
+            }
+            """.trimIndent()
+        ).classesByType
+
+        val stats = classes["TestLib::Stats"] ?: error("Stats not resolved")
+        assertTrue(!stats.metadata.isPlainStruct)
+        assertEquals(
+            mapOf("count" to 0L, "total" to 8L, "samples" to null),
+            stats.structFields.associate { it.name to it.offset }
+        )
+        val assertions = fieldOffsetAssertions(stats)
+        assertTrue(
+            assertions[0]
+                .startsWith("static_assert(std::is_standard_layout<TestLib::Stats>::value, ")
+        )
+        assertTrue(
+            assertions[1]
+                .startsWith("static_assert(offsetof(TestLib::Stats, count) == 0, ")
+        )
+        val shape = classes["TestLib::Shape"] ?: error("Shape not resolved")
+        assertEquals(listOf(null), shape.structFields.map { it.offset })
+        // Hidden mixes access levels, so Mixed isn't standard layout despite its own fields.
+        val mixed = classes["TestLib::Mixed"] ?: error("Mixed not resolved")
+        assertEquals(
+            mapOf("first" to null, "last" to null),
+            mixed.structFields.filter { it.name != "member" }.associate { it.name to it.offset }
+        )
+        assertTrue(fieldOffsetAssertions(mixed).isEmpty())
+    }
+
+    @Test
+    fun testSnapshot(): Unit = runBlocking {
+        val sensor = resolveSource(
+            """
+            namespace TestLib {
+            class Sensor {
+            public:
+                virtual ~Sensor();
+                int id;
+                const double scale = 1.0;
+                bool active;
+                int* raw;
+            };
+            }
+            """.trimIndent()
+        ).filterIsInstance<ResolvedClass>().single { it.type.toString() == "TestLib::Sensor" }
+
+        assertEquals(listOf("id", "scale", "active"), sensor.snapshotFields.map { it.name })
+        assertEquals(
+            listOf(
+                "void TestLib_Sensor_krapper_snapshot(" +
+                    "void* thiz, TestLib_Sensor_Snapshot* out)",
+                "void TestLib_Sensor_krapper_restore(" +
+                    "void* thiz, const TestLib_Sensor_Snapshot* in)"
+            ),
+            snapshotDeclarations(sensor).drop(1)
+        )
+        val functions = snapshotFunctions(sensor) { null }
+        assertTrue("out->scale = static_cast<double>(self->scale);" in functions)
+        assertTrue("self->scale =" !in functions)
+        assertTrue("restoreFields(snapshot: SensorSnapshot)" in snapshotKotlin(sensor, "pkg"))
+    }
+
+    @Test
+    fun testIterable(): Unit = runBlocking {
+        val classes = resolveSource(
+            """
+            namespace TestLib {
+            class Bag {
+            public:
+                int* begin();
+                int* end();
+            };
+            class Half {
+            public:
+                int* begin();
+                int* end(int offset);
+            };
+            class Ranged {
+            public:
+                int* begin();
+                const int* end();
+            };
+            class Counter {
+            public:
+                int begin();
+                int end();
+            };
+            }
+            """.trimIndent()
+        ).classesByType
+
+        val bag = classes["TestLib::Bag"] ?: error("Bag not resolved")
+        assertTrue(bag.isIterable)
+        assertEquals(
+            "void* TestLib_Bag_krapper_iterate(void* thiz)",
+            iterationDeclarations(bag).first()
+        )
+        assertTrue(
+            "return krapper_cursor(self->begin(), self->end());" in
+                iterationFunctions(bag) { null }
+        )
+        val half = classes["TestLib::Half"] ?: error("Half not resolved")
+        assertFalse(half.isIterable)
+        // One cursor holds both ends, so they have to be the same type.
+        val ranged = classes["TestLib::Ranged"] ?: error("Ranged not resolved")
+        assertFalse(ranged.isIterable)
+        val counter = classes["TestLib::Counter"] ?: error("Counter not resolved")
+        assertFalse(counter.isIterable)
+    }
+
     @Test
     fun testQualifiers() = memScoped {
         runBlocking {
@@ -92,6 +398,66 @@ class ParseTest {
         }
     }
 
+    @Test
+    fun testVectorElement() {
+        assertEquals(VectorElement("int", "Int"), vectorElement("std::vector<int>"))
+        assertEquals(
+            VectorElement("double", "Double"),
+            vectorElement("std::vector<double, std::allocator<double> >")
+        )
+        assertEquals(null, vectorElement("std::vector<bool>"))
+        assertEquals(null, vectorElement("std::vector<std::string>"))
+        assertEquals(null, vectorElement("std::vector<std::vector<int>>"))
+    }
+
+    @Test
+    fun testStringContainer() {
+        assertEquals(StringContainer(null), stringContainer("std::vector<std::string>"))
+        val value = stringContainer("std::map<std::string, long>")?.value
+        assertEquals("Long", value?.kotlinType)
+        // long is 4 bytes on mingwX64, so it always goes through the buffer as 8.
+        assertEquals("int64_t", value?.wireType)
+        assertEquals("double", stringContainer("std::map<std::string, double>")?.value?.wireType)
+        assertEquals(null, stringContainer("std::map<std::string, bool>"))
+    }
+
+    @Test
+    fun testSmartPointer() {
+        assertEquals(
+            SmartPointer("TestLib::TestClass", true),
+            smartPointer("std::unique_ptr<TestLib::TestClass>")
+        )
+        assertEquals(
+            SmartPointer("TestLib::TestClass", true),
+            smartPointer(
+                "std::unique_ptr<TestLib::TestClass, std::default_delete<TestLib::TestClass> >"
+            )
+        )
+        assertEquals(
+            SmartPointer("std::vector<int>", false),
+            smartPointer("std::shared_ptr<std::vector<int>>")
+        )
+        assertEquals(null, smartPointer("std::unique_ptr<int[]>"))
+        assertEquals(null, smartPointer("std::unique_ptr<std::map<int, int>>"))
+    }
+
+    @Test
+    fun testViewType() {
+        val stringView = "std::basic_string_view<char, std::char_traits<char> >"
+        assertEquals(
+            ViewType(stringView, "char", "int8_t", "kotlin.String"),
+            viewType("const $stringView&")
+        )
+        val span = "std::span<const int, 18446744073709551615UL>"
+        assertEquals(ViewType(span, "int", "int", "kotlin.IntArray"), viewType(span))
+        assertEquals(ViewType(span, "int", "int", "kotlin.IntArray"), viewType("$span const&"))
+        assertEquals(null, viewType("$stringView&"))
+        assertEquals(null, viewType("$span &"))
+        assertEquals(null, viewType("std::span<int>"))
+        assertEquals(null, viewType("std::span<const unsigned int>"))
+        assertEquals(null, viewType("std::basic_string_view<wchar_t>"))
+    }
+
     @Test
     fun testResolveConstRef() = memScoped {
         runBlocking {
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.DEFAULT_LANGUAGE_STANDARD
+import com.monkopedia.krapper.ReferencePolicy
+import com.monkopedia.krapper.generator.codegen.File
+import com.monkopedia.krapper.generator.model.WrappedElement
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedClass
+import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
+import kotlinx.cinterop.memScoped
+import platform.posix.random
+
+/**
+ * Writes [source] to a new header under /tmp, returning its path.
+ */
+fun tempHeader(source: String): String {
+    val path = "/tmp/${random()}_${random()}.hh"
+    File(path).writeText(source)
+    return path
+}
+
+/**
+ * Parses [header] and resolves the classes the default filter picks out of it, along with
+ * everything they reference.
+ */
+suspend fun resolveHeader(
+    header: String,
+    languageStandard: String = DEFAULT_LANGUAGE_STANDARD,
+    includePaths: Array<String> = emptyArray()
+): List<ResolvedElement> = memScoped {
+    val index = createIndex(0, 0) ?: error("Failed to create Index")
+    defer { index.dispose() }
+    val resolver = parseHeader(index, listOf(header), includePaths, languageStandard)
+    resolver.findClasses(WrappedElement::defaultFilter)
+        .resolveAll(resolver, ReferencePolicy.INCLUDE_MISSING)
+}
+
+/**
+ * [resolveHeader] for a header holding [source].
+ */
+suspend fun resolveSource(
+    source: String,
+    languageStandard: String = DEFAULT_LANGUAGE_STANDARD,
+    includePaths: Array<String> = emptyArray()
+): List<ResolvedElement> = resolveHeader(tempHeader(source), languageStandard, includePaths)
+
+val List<ResolvedElement>.classesByType: Map<String, ResolvedClass>
+    get() = filterIsInstance<ResolvedClass>().associateBy { it.type.toString() }
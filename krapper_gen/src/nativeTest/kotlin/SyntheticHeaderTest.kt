@@ -0,0 +1,58 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.generator.codegen.File
+import com.monkopedia.krapper.generator.model.WrappedClass
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+import kotlinx.cinterop.memScoped
+import kotlinx.coroutines.runBlocking
+import platform.posix.random
+
+class SyntheticHeaderTest {
+
+    @Test
+    fun testDeclarationCount() {
+        val header = SyntheticHeader.withDeclarations(10_000)
+
+        assertTrue(header.declarationCount in 9_000..10_000, "${header.declarationCount}")
+        val declared = Regex("class Class\\d+ [:{]").findAll(header.generate()).count()
+        assertEquals(header.classes, declared)
+    }
+
+    @Test
+    fun testParse() = memScoped {
+        runBlocking {
+            val header = SyntheticHeader(classes = 12, namespaceDepth = 3)
+            val index = createIndex(0, 0) ?: error("Failed to create Index")
+            defer { index.dispose() }
+            val tmpFile = "/tmp/${random()}_${random()}.hh"
+            File(tmpFile).writeText(header.generate())
+            val classes = parseHeader(index, listOf(tmpFile), generateIncludes("clang++"))
+                .findClasses {
+                    this is WrappedClass && type.toString().startsWith(header.namespace)
+                }
+                .map { (it as WrappedClass).type.toString() }
+
+            assertEquals(
+                (0 until 12).map { "${header.namespace}::Class$it" }.toSet(),
+                classes.filter { "Box" !in it }.toSet()
+            )
+        }
+    }
+}
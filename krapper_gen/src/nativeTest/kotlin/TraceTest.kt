@@ -0,0 +1,72 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.krapper.generator
+
+import com.monkopedia.krapper.generator.codegen.File
+import kotlin.test.AfterTest
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+import kotlinx.serialization.json.Json
+import kotlinx.serialization.json.JsonObject
+import kotlinx.serialization.json.jsonArray
+import kotlinx.serialization.json.jsonObject
+import kotlinx.serialization.json.jsonPrimitive
+import kotlinx.serialization.json.long
+
+class TraceTest {
+
+    private val file = File("/tmp/krapper_trace_test.json")
+
+    @AfterTest
+    fun cleanup() {
+        Trace.enabled = false
+    }
+
+    private fun readEvents(): List<JsonObject> =
+        Json.parseToJsonElement(file.readText()).jsonObject["traceEvents"]!!.jsonArray
+            .map { it.jsonObject }
+
+    @Test
+    fun testNestedSpans() {
+        Trace.enabled = true
+        val result = Trace.span("outer") {
+            Trace.span("inner", "detail") { 42 }
+        }
+        Trace.writeTo(file)
+
+        assertEquals(42, result)
+        val events = readEvents()
+        assertEquals(listOf("inner", "outer"), events.map { it["name"]!!.jsonPrimitive.content })
+        val (inner, outer) = events.map {
+            it["ts"]!!.jsonPrimitive.long to it["dur"]!!.jsonPrimitive.long
+        }
+        assertTrue(outer.first <= inner.first)
+        assertTrue(inner.first + inner.second <= outer.first + outer.second)
+        assertEquals(
+            "detail",
+            events[0]["args"]!!.jsonObject["detail"]!!.jsonPrimitive.content
+        )
+    }
+
+    @Test
+    fun testDisabled() {
+        Trace.span("ignored") { }
+        Trace.writeTo(file)
+
+        assertTrue(readEvents().isEmpty())
+    }
+}
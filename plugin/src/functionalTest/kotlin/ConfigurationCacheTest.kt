@@ -0,0 +1,97 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.kplusplus.plugin
+
+import java.io.File
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+import org.gradle.testkit.runner.BuildResult
+import org.gradle.testkit.runner.GradleRunner
+import org.gradle.testkit.runner.TaskOutcome
+import org.junit.Rule
+import org.junit.rules.TemporaryFolder
+
+class ConfigurationCacheTest {
+
+    @get:Rule
+    val projectDir = TemporaryFolder()
+
+    @Test
+    fun testConfigurationCacheReused() {
+        val dir = projectDir.root
+        File(dir, "settings.gradle.kts").writeText("rootProject.name = \"cctest\"\n")
+        File(dir, "build.gradle.kts").writeText(
+            """
+            plugins {
+                id("org.jetbrains.kotlin.multiplatform")
+                id("com.monkopedia.kplusplus.plugin")
+            }
+
+            repositories {
+                mavenCentral()
+            }
+
+            kotlin {
+                linuxX64()
+            }
+
+            kplusplus {
+                import("cctest") {
+                    headers.srcDir("include")
+                    library.srcDir("lib")
+                }
+            }
+            """.trimIndent()
+        )
+        File(dir, "include").mkdirs()
+        File(dir, "lib").mkdirs()
+        File(dir, "include/cctest.h").writeText(
+            """
+            class Counter {
+            public:
+                Counter();
+                int count(int step);
+            };
+            """.trimIndent()
+        )
+
+        val first = build(dir)
+        assertTrue(first.output.contains("Configuration cache entry stored"), first.output)
+        val generated = generatedFiles(dir)
+        assertTrue(generated.isNotEmpty())
+
+        File(dir, "build/krapped_imports").deleteRecursively()
+        val second = build(dir)
+        assertTrue(second.output.contains("Reusing configuration cache"), second.output)
+        assertEquals(TaskOutcome.SUCCESS, second.task(":cctestMain")?.outcome)
+        assertEquals(generated, generatedFiles(dir))
+    }
+
+    private fun build(dir: File): BuildResult = GradleRunner.create()
+        .withProjectDir(dir)
+        .withPluginClasspath()
+        .withArguments("cctestMain", "--configuration-cache", "--stacktrace")
+        .build()
+
+    // The compiled library isn't byte for byte reproducible, only compare the sources.
+    private fun generatedFiles(dir: File): Map<String, String> {
+        val root = File(dir, "build/krapped_imports")
+        return root.walkTopDown()
+            .filter { it.isFile && it.extension in setOf("kt", "def", "h", "cc", "cpp") }
+            .associate { it.relativeTo(root).path to it.readText() }
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.kplusplus
+
+import com.monkopedia.krapper.DefaultFilter
+import com.monkopedia.krapper.FilterDefinition
+import java.io.File
+import java.lang.reflect.Modifier
+import java.security.MessageDigest
+import kotlinx.serialization.json.Json
+
+/**
+ * Stable string forms of the task inputs Gradle can't fingerprint itself, used as
+ * build cache keys for the krapper tasks.
+ */
+internal object Fingerprints {
+    private val json = Json {
+        encodeDefaults = true
+    }
+
+    fun filter(filter: FilterDefinition?): String =
+        json.encodeToString(FilterDefinition.serializer(), filter ?: DefaultFilter)
+
+    fun parseFilter(fingerprint: String): FilterDefinition =
+        json.decodeFromString(FilterDefinition.serializer(), fingerprint)
+
+    /**
+     * Hash of the bytecode holding [code] along with the values it captured. Lambdas compiled
+     * through invokedynamic are hidden classes with no bytecode of their own, their bodies live
+     * on the declaring class so that class is hashed instead.
+     */
+    fun code(code: Any): String {
+        val cls = code.javaClass
+        val declaring = if (cls.isHidden) cls.name.substringBefore("$$") else cls.name
+        val bytes = cls.classLoader
+            ?.getResourceAsStream(declaring.replace('.', '/') + ".class")
+            ?.use { it.readBytes() }
+        val hash = bytes?.let { "@${sha256(it)}" }.orEmpty()
+        return "$declaring$hash${captures(code)}"
+    }
+
+    /**
+     * Captured values live in the instance fields of the lambda. Anything without a stable
+     * string form falls back to its identity, which misses the cache rather than hitting a
+     * stale entry.
+     */
+    private fun captures(code: Any): String {
+        val fields = generateSequence<Class<*>>(code.javaClass) { it.superclass }
+            .takeWhile { it != Any::class.java }
+            .flatMap { it.declaredFields.asSequence() }
+            .filter { !Modifier.isStatic(it.modifiers) }
+            .toList()
+        if (fields.isEmpty()) return ""
+        return fields.joinToString(",", "[", "]") { field ->
+            val value = if (field.trySetAccessible()) {
+                value(field.get(code))
+            } else {
+                "?${System.identityHashCode(code)}"
+            }
+            "${field.name}=$value"
+        }
+    }
+
+    private fun value(value: Any?): String = when (value) {
+        null, is String, is Number, is Boolean, is Char, is Enum<*> -> value.toString()
+        is Collection<*> -> value.joinToString(",", "[", "]") { value(it) }
+        is Map<*, *> -> value.entries.joinToString(",", "{", "}") {
+            "${value(it.key)}=${value(it.value)}"
+        }
+        is Function<*> -> code(value)
+        else -> "${value.javaClass.name}@${System.identityHashCode(value)}"
+    }
+
+    /**
+     * Location and content hash of the compiler binary, looked up on the PATH when only a name
+     * is given. The location matters because the include paths it reports end up in the output.
+     */
+    fun compiler(compiler: String): String {
+        val file = File(compiler).takeIf { it.isFile }
+            ?: System.getenv("PATH").orEmpty().split(File.pathSeparator)
+                .map { File(it, compiler) }
+                .firstOrNull { it.isFile }
+            ?: return compiler
+        return "${file.absolutePath}@${sha256(file.readBytes())}"
+    }
+
+    private fun sha256(bytes: ByteArray): String = MessageDigest.getInstance("SHA-256")
+        .digest(bytes)
+        .joinToString("") { "%02x".format(it) }
+}
@@ -15,10 +15,13 @@
  */
 package com.monkopedia.kplusplus
 
+import com.monkopedia.krapper.CallInstrumentation
+import com.monkopedia.krapper.DEFAULT_LANGUAGE_STANDARD
 import com.monkopedia.krapper.ErrorPolicy
 import com.monkopedia.krapper.ErrorPolicy.LOG
 import com.monkopedia.krapper.FilterDefinition
 import com.monkopedia.krapper.FilterDsl
+import com.monkopedia.krapper.KrapperConfig
 import com.monkopedia.krapper.MappingScope
 import com.monkopedia.krapper.MappingService
 import com.monkopedia.krapper.ReferencePolicy
@@ -29,6 +32,7 @@ import com.monkopedia.krapper.generator.resolvedmodel.ResolvedElement
 import com.monkopedia.krapper.typedMapping
 import javax.inject.Inject
 import org.gradle.api.Action
+import org.gradle.api.DomainObjectSet
 import org.gradle.api.file.SourceDirectorySet
 import org.gradle.api.model.ObjectFactory
 import org.gradle.api.tasks.Input
@@ -44,10 +48,15 @@ open class KPlusPlusExtension(
     @Nested
     open val config: KPlusPlusConfig,
     @Inject
-    open val objectFactory: ObjectFactory,
-    @Nested
-    open val imports: MutableList<ImportConfig> = mutableListOf()
+    open val objectFactory: ObjectFactory
 ) {
+    /**
+     * Imports declared so far, the plugin wires each one up to its compilations as it is added.
+     */
+    @Nested
+    open val imports: DomainObjectSet<ImportConfig> =
+        objectFactory.domainObjectSet(ImportConfig::class.java)
+
     fun config(action: Action<KPlusPlusConfig>) {
         action.execute(config)
     }
@@ -55,7 +64,8 @@ open class KPlusPlusExtension(
     fun import(name: String? = null, configure: Action<ImportConfig>) {
         // TODO: Migrate to named container
         val name = name ?: "import${imports.size}"
-        val config = imports.find { it.name == name }
+        val existing = imports.find { it.name == name }
+        val config = existing
             ?: ImportConfig(
                 name,
                 headers = objectFactory.sourceDirectorySet(
@@ -66,8 +76,11 @@ open class KPlusPlusExtension(
                     "${name}Library",
                     "Library files for kplusplus $name import"
                 )
-            ).also { imports.add(it) }
+            )
         configure.execute(config)
+        if (existing == null) {
+            imports.add(config)
+        }
     }
 }
 
@@ -75,27 +88,40 @@ open class ImportConfig(
     @Optional
     @Input
     open var name: String? = null,
-    @Optional
-    @Input
+    @Internal
     open var compilations: MutableList<KotlinNativeCompilation>? = mutableListOf(),
-    @Optional
-    @Input
+    @Internal
     open var classFilter: FilterDefinition? = null,
     @InputFiles
-    @PathSensitive(PathSensitivity.RELATIVE)
+    @PathSensitive(PathSensitivity.ABSOLUTE)
     open val headers: SourceDirectorySet,
     @InputFiles
-    @PathSensitive(PathSensitivity.RELATIVE)
+    @PathSensitive(PathSensitivity.ABSOLUTE)
     open val library: SourceDirectorySet,
     @Internal
-    open val mappings: MutableList<MappingService> = mutableListOf()
+    open val mappings: MutableList<MappingService> = mutableListOf(),
+    /**
+     * Cache keys for [mappings], one per mapping. Mappings added without one make the
+     * generation tasks uncacheable.
+     */
+    @Input
+    open val mappingFingerprints: MutableList<String> = mutableListOf(),
+    /**
+     * Parse and resolve once for all compilations of this import that share a data model
+     * (LP64, LLP64 or ILP32), rather than once per target. Only enable this when the headers
+     * don't change with the target OS, since the shared model carries its folded constants.
+     */
+    @Input
+    open var sharedAnalysis: Boolean = false
 ) {
 
     inline fun <reified T : ResolvedElement> map(
         type: TypeTarget<T>,
         builder: MappingBuilder<T>.() -> Unit
     ) {
-        mappings.add(MappingBuilder(type).also(builder).toMappingService())
+        val mappingBuilder = MappingBuilder(type).also(builder)
+        mappings.add(mappingBuilder.toMappingService())
+        mappingFingerprints.add(mappingBuilder.fingerprint())
     }
 
     inline fun classFilter(crossinline filter: FilterDsl.() -> FilterDefinition) {
@@ -113,6 +139,16 @@ open class MappingBuilder<T : ResolvedElement>(
         val mappingMethod = mappingMethod ?: error("No handler defined for mapping")
         return typedMapping(type, { filterMethod() }, { mappingMethod(it) })
     }
+
+    fun fingerprint(): String {
+        val filterMethod = filterMethod ?: error("No filter defined for mapping")
+        val mappingMethod = mappingMethod ?: error("No handler defined for mapping")
+        return listOf(
+            type.filterType.name,
+            Fingerprints.filter(filter(filterMethod)),
+            Fingerprints.code(mappingMethod)
+        ).joinToString("|")
+    }
 }
 
 inline fun <reified T : ResolvedElement> MappingBuilder<T>.find(
@@ -149,5 +185,36 @@ open class KPlusPlusConfig(
     @Input
     open var referencePolicy: ReferencePolicy = INCLUDE_MISSING,
     @Input
-    open var debug: Boolean = false
+    open var debug: Boolean = false,
+    /**
+     * Write a Chrome trace of each krapper run into its output directory, for finding where
+     * generation time goes.
+     */
+    @Input
+    open var trace: Boolean = false,
+    /**
+     * Compile call counters (COUNT) or counters and timers (TIME) into the generated wrappers,
+     * read back through the generated `<ModuleName>CallStats` object, or USDT probes (PROBES).
+     */
+    @Input
+    open var instrumentation: CallInstrumentation = CallInstrumentation.NONE,
+    /**
+     * C++ standard used to parse the headers and compile the wrappers, e.g. `c++17` for headers
+     * that use `std::string_view`.
+     */
+    @Input
+    open var languageStandard: String = DEFAULT_LANGUAGE_STANDARD
 )
+
+fun KPlusPlusConfig.toKrapperConfig(defaultCompiler: () -> String): KrapperConfig =
+    KrapperConfig(
+        pkg ?: "krapper.$moduleName",
+        compiler ?: defaultCompiler(),
+        moduleName,
+        errorPolicy,
+        referencePolicy,
+        debug,
+        trace,
+        instrumentation,
+        languageStandard
+    )
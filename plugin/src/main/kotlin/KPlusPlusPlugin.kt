@@ -15,208 +15,297 @@
  */
 package com.monkopedia.kplusplus
 
-import com.monkopedia.krapper.DefaultFilter
-import com.monkopedia.krapper.IndexRequest
 import com.monkopedia.krapper.KrapperConfig
-import com.monkopedia.krapper.RemoteLogger
-import java.io.File
-import java.util.Properties
-import kotlinx.coroutines.runBlocking
+import com.monkopedia.krapper.MappingService
+import javax.inject.Inject
+import kotlinx.serialization.json.Json
 import org.gradle.api.DefaultTask
-import org.gradle.api.GradleException
 import org.gradle.api.Plugin
 import org.gradle.api.Project
+import org.gradle.api.Task
+import org.gradle.api.file.ConfigurableFileCollection
+import org.gradle.api.file.DirectoryProperty
+import org.gradle.api.file.RegularFile
+import org.gradle.api.file.RegularFileProperty
+import org.gradle.api.provider.ListProperty
+import org.gradle.api.provider.Property
+import org.gradle.api.provider.Provider
+import org.gradle.api.specs.Spec
+import org.gradle.api.tasks.CacheableTask
 import org.gradle.api.tasks.Input
+import org.gradle.api.tasks.InputFile
+import org.gradle.api.tasks.InputFiles
 import org.gradle.api.tasks.Internal
 import org.gradle.api.tasks.Nested
+import org.gradle.api.tasks.Optional
 import org.gradle.api.tasks.OutputDirectory
+import org.gradle.api.tasks.OutputFile
+import org.gradle.api.tasks.PathSensitive
+import org.gradle.api.tasks.PathSensitivity
 import org.gradle.api.tasks.TaskAction
-import org.gradle.work.DisableCachingByDefault
+import org.gradle.workers.WorkerExecutor
 import org.jetbrains.kotlin.gradle.dsl.KotlinMultiplatformExtension
+import org.jetbrains.kotlin.gradle.plugin.KotlinCompilation
 import org.jetbrains.kotlin.gradle.plugin.mpp.KotlinNativeCompilation
+import org.jetbrains.kotlin.gradle.plugin.mpp.KotlinNativeTarget
+import org.jetbrains.kotlin.konan.target.Family
+import org.jetbrains.kotlin.konan.target.HostManager
 import org.jetbrains.kotlin.konan.target.KonanTarget
 
 open class KPlusPlusPlugin : Plugin<Project> {
     override fun apply(target: Project) {
-        target.extensions.create(
+        val ext = target.extensions.create(
             "kplusplus",
             KPlusPlusExtension::class.java,
             KPlusPlusConfig(moduleName = target.name)
         )
-        target.afterEvaluate {
-            val ext = target.extensions.getByName("kplusplus") as KPlusPlusExtension
+        val krapperService = target.gradle.sharedServices.registerIfAbsent(
+            KrapperGenService.NAME,
+            KrapperGenService::class.java
+        ) { spec ->
+            spec.parameters.exeHome.set(target.rootProject.layout.buildDirectory.dir("krapperExe"))
+            spec.parameters.idleTimeoutSeconds.set(
+                target.providers.gradleProperty(KrapperGenService.IDLE_TIMEOUT_PROPERTY)
+                    .map { it.toLong() }
+            )
+        }
+        target.plugins.withId("org.jetbrains.kotlin.multiplatform") {
             val kotlinExt = target.extensions.getByType(KotlinMultiplatformExtension::class.java)
-
-            val importsDir = File(
-                target.layout.buildDirectory.get().asFile,
-                "krapped_imports"
-            ).also {
-                it.mkdirs()
+            ext.imports.all { import ->
+                ImportWiring(target, ext, import, krapperService).connect(kotlinExt)
             }
-            for ((index, import) in ext.imports.withIndex()) {
-                val compilations = import.compilations?.takeIf { it.isNotEmpty() }
-                    ?: kotlinExt.targets.flatMap {
-                        it.compilations.filterIsInstance<KotlinNativeCompilation>()
-                            .filter { compilation -> compilation.name == "main" }
-                    }
-                compilations.forEach { compilation ->
-                    val importName =
-                        (import.name ?: "${target.name}${if (index != 0) index else ""}") +
-                            compilation.name.capitalize()
-                    val outputDir = File(importsDir, importName).also {
-                        it.mkdirs()
-                    }
-                    val krapTask =
-                        target.tasks.register(importName, RunKrapperGenTask::class.java) { task ->
-                            task.target = compilation.konanTarget
-                            task.config = ext.config
-                            task.import = import
-                            task.exeHome =
-                                File(target.layout.buildDirectory.get().asFile, "krapperExe").also {
-                                    it.mkdirs()
-                                }
-                            task.outputDirectory = outputDir
-                        }
-                    compilation.cinterops { interops ->
-                        interops.create(importName) { interop ->
-                            interop.defFile = File(outputDir, "${ext.config.moduleName}.def")
-                            val targetTaskName = interop.interopProcessingTaskName
-                            target.tasks.all { task ->
-                                if (task.name == targetTaskName) {
-                                    task.dependsOn(krapTask)
-                                    task.mustRunAfter(krapTask)
-                                }
-                            }
-                            interop.interopProcessingTaskName
-                        }
-                    }
-                    compilation.defaultSourceSet.kotlin.apply {
-                        srcDir(File(outputDir, "src"))
-                    }
+        }
+    }
+}
+
+/**
+ * Registers the tasks for one import and hooks them into each of its compilations as those are
+ * created. Everything is passed to the tasks as providers so nothing is resolved until the task
+ * graph needs it.
+ */
+private class ImportWiring(
+    private val project: Project,
+    private val ext: KPlusPlusExtension,
+    private val import: ImportConfig,
+    private val krapperService: Provider<KrapperGenService>
+) {
+    private val baseName = import.name ?: project.name
+    private val importsDir = project.layout.buildDirectory.dir("krapped_imports")
+    private val analysisGroups = mutableMapOf<String, AnalysisGroup>()
+
+    /**
+     * Targets sharing one analysis. The model holds sizes, offsets and folded constants, so only
+     * targets with the same data model share, and a group of one skips the extra task.
+     */
+    private inner class AnalysisGroup(dataModel: String) {
+        val targets = mutableListOf<KonanTarget>()
+        private val name = "${baseName}Analysis$dataModel"
+        private val task =
+            project.tasks.register(name, AnalyzeKrapperTask::class.java) { task ->
+                // Prefer analyzing with the host toolchain, any target in the group works.
+                val analysisTarget = project.provider {
+                    targets.firstOrNull { it == HostManager.host } ?: targets.first()
                 }
+                configure(task, analysisTarget)
+                task.modelFile.set(importsDir.map { it.file("$name/model.json") })
             }
+        val modelFile: Provider<RegularFile> = project.provider { targets.size > 1 }
+            .flatMap { shared ->
+                if (shared) task.flatMap { it.modelFile } else project.provider { null }
+            }
+    }
+
+    fun connect(kotlinExt: KotlinMultiplatformExtension) {
+        val compilations = import.compilations?.takeIf { it.isNotEmpty() }
+        if (compilations != null) {
+            compilations.forEach { add(it) }
+            return
+        }
+        kotlinExt.targets.withType(KotlinNativeTarget::class.java).all { nativeTarget ->
+            nativeTarget.compilations
+                .matching { it.name == KotlinCompilation.MAIN_COMPILATION_NAME }
+                .all { add(it) }
+        }
+    }
+
+    private fun add(compilation: KotlinNativeCompilation) {
+        val importName = baseName + compilation.name.capitalize()
+        val analysisGroup = if (import.sharedAnalysis) {
+            val dataModel = dataModel(compilation.konanTarget)
+            analysisGroups.getOrPut(dataModel) { AnalysisGroup(dataModel) }.also {
+                it.targets.add(compilation.konanTarget)
+            }
+        } else {
+            null
+        }
+        val krapTask = project.tasks.register(importName, RunKrapperGenTask::class.java) { task ->
+            configure(task, project.provider { compilation.konanTarget })
+            task.outputDirectory.set(importsDir.map { it.dir(importName) })
+            task.mappings = import.mappings
+            task.mappingFingerprints.addAll(project.provider { import.mappingFingerprints })
+            if (import.mappings.isNotEmpty()) {
+                task.notCompatibleWithConfigurationCache(
+                    "Mappings run build script code, which can't be restored from the cache"
+                )
+            }
+            if (analysisGroup != null) {
+                task.modelFile.set(analysisGroup.modelFile)
+            }
+        }
+        compilation.cinterops.create(importName) { interop ->
+            interop.definitionFile.set(krapTask.flatMap { it.defFile })
+        }
+        compilation.defaultSourceSet.kotlin.srcDir(
+            krapTask.flatMap { it.outputDirectory.dir("src") }
+        )
+    }
+
+    private fun configure(task: KrapperTask, konanTarget: Provider<KonanTarget>) {
+        task.targetName.set(konanTarget.map { it.name })
+        task.compiler.set(compilerFor(konanTarget))
+        task.config = ext.config
+        task.headers.from(import.headers)
+        task.libraries.from(import.library)
+        task.classFilter.set(project.provider { Fingerprints.filter(import.classFilter) })
+        task.krapperService.set(krapperService)
+        task.usesService(krapperService)
+    }
+
+    private fun dataModel(target: KonanTarget): String = when {
+        target.architecture.bitness == 32 -> "Ilp32"
+        target.family == Family.MINGW -> "Llp64"
+        else -> "Lp64"
+    }
+
+    private fun compilerFor(konanTarget: Provider<KonanTarget>): Provider<String> {
+        val extra = project.extensions.extraProperties
+        return konanTarget.map {
+            ext.config.compiler ?: findCompiler(extra.get("konanHome").toString(), it)
         }
     }
 }
 
-@DisableCachingByDefault(because = "Runs an external code generator process")
-abstract class RunKrapperGenTask : DefaultTask() {
-    @Input
-    var target: KonanTarget? = null
+/**
+ * Shared setup for tasks that talk to krapper_gen, configuring the service for [targetName].
+ */
+abstract class KrapperTask : DefaultTask() {
+    @get:Input
+    abstract val targetName: Property<String>
+
+    /**
+     * Path or name of the compiler, its contents are tracked through [compilerFingerprint].
+     */
+    @get:Internal
+    abstract val compiler: Property<String>
+
+    @get:Input
+    abstract val compilerFingerprint: Property<String>
 
     @Nested
     var config: KPlusPlusConfig? = null
 
-    @Nested
-    var import: ImportConfig? = null
+    // The generated .def and wrappers embed absolute paths, so a move must miss the cache.
+    @get:InputFiles
+    @get:PathSensitive(PathSensitivity.ABSOLUTE)
+    abstract val headers: ConfigurableFileCollection
 
-    @OutputDirectory
-    var outputDirectory: File? = null
+    @get:InputFiles
+    @get:PathSensitive(PathSensitivity.ABSOLUTE)
+    abstract val libraries: ConfigurableFileCollection
 
-    @Internal
-    var exeHome: File? = null
+    /**
+     * Filter selecting the classes to wrap, held in its serialized form.
+     */
+    @get:Input
+    abstract val classFilter: Property<String>
 
-    @TaskAction
-    fun execute() = try {
-        runBlocking {
-            val exe = KrapperGenExecutable.getExeFile(exeHome ?: error("Missing home"))
-            KrapperExecution.executeWithService(exe) { service ->
-                val config = config ?: error("Missing config")
-                val import = import ?: error("Missing import")
-                service.setLogger(object : RemoteLogger {
-                    override suspend fun e(message: String) {
-                        println(message)
-                    }
-
-                    override suspend fun i(message: String) {
-                        println(message)
-                    }
-
-                    override suspend fun w(message: String) {
-                        println(message)
-                    }
-                })
-                service.setConfig(
-                    KrapperConfig(
-                        config.pkg ?: "krapper.${config.moduleName}",
-                        config.compiler ?: findCompiler(),
-                        config.moduleName,
-                        config.errorPolicy,
-                        config.referencePolicy,
-                        config.debug
-                    ).also {
-                        println("Setting krapper config to $it")
-                    }
-                )
-                val index = service.index(
-                    IndexRequest(
-                        import.headers.files.map { it.absolutePath },
-                        import.library.files.map { it.absolutePath }
-                    ).also {
-                        println("Requesting index $it")
-                    }
-                )
-                println("Filtering")
-                index.filterAndResolve(import.classFilter ?: DefaultFilter)
+    @get:Internal
+    abstract val krapperService: Property<KrapperGenService>
 
-                for (mapping in import.mappings) {
-                    println("Adding mapping")
-                    index.addMapping(mapping)
-                }
-                println("Writing output")
-                index.writeTo((outputDirectory ?: error("No output directory")).absolutePath)
-                println("Closing imdex")
-                try {
-                    index.close()
-                } catch (t: Throwable) {
-                }
-            }
-            println("Done with service")
-        }
-        println("Done with task")
-    } catch (t: Throwable) {
-        throw RuntimeException("Problem executing krapper: ${t.message}", t)
+    @get:Inject
+    abstract val workerExecutor: WorkerExecutor
+
+    init {
+        compilerFingerprint.convention(compiler.map(Fingerprints::compiler))
     }
 
-    private fun findCompiler(): String {
-        val kotlinNativeDataPath = project.extensions.extraProperties.get("konanHome").toString()
-        val konanDir = File(File(kotlinNativeDataPath), "konan")
-        if (!konanDir.exists()) {
-            throw GradleException("Can't find konan dir in $kotlinNativeDataPath")
-        }
-        val propertiesFile = File(konanDir, "konan.properties")
-        if (!propertiesFile.exists()) {
-            throw GradleException("Can't find konan properties in $kotlinNativeDataPath")
-        }
-        val props = Properties().also { props ->
-            propertiesFile.inputStream().use {
-                props.load(it)
-            }
-        }
-        // /home/jmonk/.konan/dependencies/x86_64-unknown-linux-gnu-gcc-8.3.0-glibc-2.19-kernel-4.9-2/bin/x86_64-unknown-linux-gnu-g++
-        // ~/.konan/kotlin-native-prebuilt-linux-x86_64-1.7.10/konan/konan.properties
-        val toolchain = resolveKonanProperty(props, "gccToolchain.${target!!.name}")
-            ?: error("Can't find default gcc, please specify compiler manually")
-        val konanHomeParent = konanDir.parentFile.parentFile
-        val dependencies = File(konanHomeParent, "dependencies")
-        val gccDir = File(dependencies, toolchain)
-        if (!gccDir.exists()) {
-            error("Can't find default gcc, please specify compiler manually")
+    /**
+     * Queues the krapper work for this task, letting Gradle run other tasks in the project
+     * while it is in progress.
+     */
+    protected fun submitKrapper(configure: (KrapperWorkAction.Params) -> Unit) {
+        val config = (config ?: error("Missing config")).toKrapperConfig { compiler.get() }
+        workerExecutor.noIsolation().submit(KrapperWorkAction::class.java) { params ->
+            params.krapperService.set(krapperService)
+            params.config.set(Json.encodeToString(KrapperConfig.serializer(), config))
+            params.headers.from(headers)
+            params.libraries.from(libraries)
+            params.classFilter.set(classFilter)
+            configure(params)
         }
-        val gppFile = gccDir.walkBottomUp().find { file ->
-            file.isFile && file.canExecute() && file.name.endsWith("g++")
-        }
-        if (gppFile == null || !gppFile.exists()) {
-            error("Can't find default gcc, please specify compiler manually")
+    }
+}
+
+@CacheableTask
+abstract class AnalyzeKrapperTask : KrapperTask() {
+    @get:OutputFile
+    abstract val modelFile: RegularFileProperty
+
+    @TaskAction
+    fun execute() = submitKrapper { params ->
+        params.exportModel.set(modelFile)
+    }
+}
+
+@CacheableTask
+abstract class RunKrapperGenTask : KrapperTask() {
+    @get:OutputDirectory
+    abstract val outputDirectory: DirectoryProperty
+
+    /**
+     * Model from an [AnalyzeKrapperTask] shared with other targets, when set the headers are
+     * not parsed again.
+     */
+    @get:Optional
+    @get:InputFile
+    @get:PathSensitive(PathSensitivity.NONE)
+    abstract val modelFile: RegularFileProperty
+
+    /**
+     * Kept out of the task state the configuration cache stores, a task with mappings opts out
+     * of the configuration cache instead.
+     */
+    @get:Internal
+    @Transient
+    var mappings: List<MappingService> = emptyList()
+
+    /**
+     * Cache keys for [mappings], see [ImportConfig.mappingFingerprints].
+     */
+    @get:Input
+    abstract val mappingFingerprints: ListProperty<String>
+
+    @get:Internal
+    val defFile: Provider<RegularFile>
+        get() = outputDirectory.map { it.file("${config?.moduleName}.def") }
+
+    init {
+        outputs.cacheIf("all mappings have fingerprints", AllMappingsFingerprinted)
+    }
+
+    @TaskAction
+    fun execute() = submitKrapper { params ->
+        params.importModel.set(modelFile)
+        params.outputDirectory.set(outputDirectory)
+        if (mappings.isNotEmpty()) {
+            params.mappings.set(PendingMappings.put(path, mappings))
         }
-        return gppFile.absolutePath
     }
 
-    private fun resolveKonanProperty(props: Properties, key: String): String? {
-        val value = props[key]?.toString() ?: return null
-        return Regex("\\$\\{?(\\w+(?:\\.\\w+)*)\\}?").replace(value) { match ->
-            val refKey = match.groupValues[1]
-            resolveKonanProperty(props, refKey) ?: match.value
+    // A named spec rather than a lambda so the configuration cache can store it.
+    private object AllMappingsFingerprinted : Spec<Task> {
+        override fun isSatisfiedBy(task: Task): Boolean = (task as RunKrapperGenTask).let {
+            it.mappings.size == it.mappingFingerprints.get().size
         }
     }
 }
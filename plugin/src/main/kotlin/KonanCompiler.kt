@@ -0,0 +1,65 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.kplusplus
+
+import java.io.File
+import java.util.Properties
+import org.gradle.api.GradleException
+import org.jetbrains.kotlin.konan.target.KonanTarget
+
+/**
+ * Locates the g++ from the gcc toolchain konan uses for [target].
+ */
+internal fun findCompiler(konanHome: String, target: KonanTarget): String {
+    val konanDir = File(File(konanHome), "konan")
+    if (!konanDir.exists()) {
+        throw GradleException("Can't find konan dir in $konanHome")
+    }
+    val propertiesFile = File(konanDir, "konan.properties")
+    if (!propertiesFile.exists()) {
+        throw GradleException("Can't find konan properties in $konanHome")
+    }
+    val props = Properties().also { props ->
+        propertiesFile.inputStream().use {
+            props.load(it)
+        }
+    }
+    // /home/jmonk/.konan/dependencies/x86_64-unknown-linux-gnu-gcc-8.3.0-glibc-2.19-kernel-4.9-2/bin/x86_64-unknown-linux-gnu-g++
+    // ~/.konan/kotlin-native-prebuilt-linux-x86_64-1.7.10/konan/konan.properties
+    val toolchain = resolveKonanProperty(props, "gccToolchain.${target.name}")
+        ?: error("Can't find default gcc, please specify compiler manually")
+    val konanHomeParent = konanDir.parentFile.parentFile
+    val dependencies = File(konanHomeParent, "dependencies")
+    val gccDir = File(dependencies, toolchain)
+    if (!gccDir.exists()) {
+        error("Can't find default gcc, please specify compiler manually")
+    }
+    val gppFile = gccDir.walkBottomUp().find { file ->
+        file.isFile && file.canExecute() && file.name.endsWith("g++")
+    }
+    if (gppFile == null || !gppFile.exists()) {
+        error("Can't find default gcc, please specify compiler manually")
+    }
+    return gppFile.absolutePath
+}
+
+private fun resolveKonanProperty(props: Properties, key: String): String? {
+    val value = props[key]?.toString() ?: return null
+    return Regex("\\$\\{?(\\w+(?:\\.\\w+)*)\\}?").replace(value) { match ->
+        val refKey = match.groupValues[1]
+        resolveKonanProperty(props, refKey) ?: match.value
+    }
+}
@@ -22,13 +22,42 @@ import com.monkopedia.ksrpc.ksrpcEnvironment
 import com.monkopedia.ksrpc.sockets.asConnection
 import com.monkopedia.ksrpc.toStub
 import java.io.File
+import java.util.concurrent.Executors
+import java.util.concurrent.TimeUnit
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.runBlocking
 import kotlinx.coroutines.withContext
+import kotlinx.coroutines.withTimeout
 import kotlinx.serialization.json.Json
 
-object KrapperExecution {
-    suspend fun executeWithService(executable: File, execute: suspend (KrapperService) -> Unit) {
-        withContext(Dispatchers.IO) {
+/**
+ * A running `krapper_gen -s` process and the service stub connected to it.
+ */
+class KrapperProcess private constructor(
+    val executable: File,
+    val service: KrapperService,
+    private val closeConnection: suspend () -> Unit
+) {
+    suspend fun isAlive(): Boolean = try {
+        withTimeout(PING_TIMEOUT_MS) {
+            service.ping("alive")
+        }
+        true
+    } catch (t: Throwable) {
+        false
+    }
+
+    suspend fun close() {
+        try {
+            closeConnection()
+        } catch (_: Throwable) {
+        }
+    }
+
+    companion object {
+        private const val PING_TIMEOUT_MS = 5_000L
+
+        suspend fun start(executable: File): KrapperProcess = withContext(Dispatchers.IO) {
             val process = ProcessBuilder()
                 .command(executable.absolutePath, "-s")
             val env = ksrpcEnvironment(
@@ -41,15 +70,57 @@ object KrapperExecution {
                 }
             }
             val connection = process.asConnection(env)
-            try {
-                val service = connection.defaultChannel().toStub<KrapperService, String>()
-                execute(service)
-            } finally {
-                try {
-                    connection.close()
-                } catch (_: Throwable) {
-                }
+            val service = connection.defaultChannel().toStub<KrapperService, String>()
+            KrapperProcess(executable, service) { connection.close() }
+        }
+    }
+}
+
+/**
+ * Keeps krapper processes running between builds in the same Gradle daemon, so the next build
+ * gets processes with their include paths and parses already cached. Parked processes are shut
+ * down once they have been idle for longer than the timeout they were released with.
+ */
+object KrapperProcessPool {
+    private val idle = mutableMapOf<String, MutableList<Parked>>()
+    private val reaper = Executors.newSingleThreadScheduledExecutor { runnable ->
+        Thread(runnable, "krapper-process-reaper").also { it.isDaemon = true }
+    }
+
+    private class Parked(val process: KrapperProcess)
+
+    suspend fun acquire(executable: File): KrapperProcess {
+        while (true) {
+            val parked = synchronized(idle) {
+                idle[executable.absolutePath]?.removeLastOrNull()
+            } ?: break
+            if (parked.process.isAlive()) {
+                return parked.process
             }
+            parked.process.close()
+        }
+        return KrapperProcess.start(executable)
+    }
+
+    fun release(process: KrapperProcess, idleTimeoutSeconds: Long) {
+        if (idleTimeoutSeconds <= 0) {
+            runBlocking { process.close() }
+            return
+        }
+        val key = process.executable.absolutePath
+        val parked = Parked(process)
+        synchronized(idle) {
+            idle.getOrPut(key) { mutableListOf() }.add(parked)
+        }
+        reaper.schedule({ expire(key, parked) }, idleTimeoutSeconds, TimeUnit.SECONDS)
+    }
+
+    private fun expire(key: String, parked: Parked) {
+        val expired = synchronized(idle) {
+            idle[key]?.let { list -> list.removeIf { it === parked } } == true
+        }
+        if (expired) {
+            runBlocking { parked.process.close() }
         }
     }
 }
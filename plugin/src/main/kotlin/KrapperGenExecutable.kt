@@ -16,10 +16,13 @@
 package com.monkopedia.kplusplus
 
 import java.io.File
+import java.nio.file.Files
+import java.nio.file.StandardCopyOption
 
 object KrapperGenExecutable {
     private var libsFile: File? = null
 
+    @Synchronized
     fun getExeFile(exeHome: File): File = libsFile ?: createExeFile(exeHome).also {
         libsFile = it
     }
@@ -29,11 +32,20 @@ object KrapperGenExecutable {
             if (!exeFile.parentFile.exists()) {
                 exeFile.parentFile.mkdirs()
             }
-            exeFile.outputStream().use { output ->
+            // Write beside and rename over, a kept alive process may still be running the
+            // previous copy and it can't be opened for writing.
+            val tmpFile = File.createTempFile("krapper_gen", ".kexe", exeFile.parentFile)
+            tmpFile.outputStream().use { output ->
                 this::class.java.getResourceAsStream("/krapper_gen.kexe").use {
                     it.copyTo(output)
                 }
             }
-            exeFile.setExecutable(true)
+            tmpFile.setExecutable(true)
+            Files.move(
+                tmpFile.toPath(),
+                exeFile.toPath(),
+                StandardCopyOption.REPLACE_EXISTING,
+                StandardCopyOption.ATOMIC_MOVE
+            )
         }
 }
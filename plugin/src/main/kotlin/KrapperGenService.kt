@@ -0,0 +1,84 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.kplusplus
+
+import com.monkopedia.krapper.KrapperService
+import org.gradle.api.file.DirectoryProperty
+import org.gradle.api.provider.Property
+import org.gradle.api.services.BuildService
+import org.gradle.api.services.BuildServiceParameters
+
+/**
+ * Shares krapper_gen processes between all of the generation tasks in a build, starting another
+ * one only when every existing process is busy with a concurrent import. The processes are
+ * handed to [KrapperProcessPool] when the build finishes, so following builds in the same daemon
+ * keep their caches.
+ */
+abstract class KrapperGenService :
+    BuildService<KrapperGenService.Params>,
+    AutoCloseable {
+    interface Params : BuildServiceParameters {
+        val exeHome: DirectoryProperty
+        val idleTimeoutSeconds: Property<Long>
+    }
+
+    private val idle = ArrayDeque<KrapperProcess>()
+
+    /**
+     * Runs [execute] against a process nobody else is using, since each process holds the
+     * config for the request in progress.
+     */
+    suspend fun <T> withService(execute: suspend (KrapperService) -> T): T {
+        val current = takeIdle() ?: KrapperProcessPool.acquire(
+            KrapperGenExecutable.getExeFile(parameters.exeHome.get().asFile)
+        )
+        val result = try {
+            execute(current.service)
+        } catch (t: Throwable) {
+            // Don't hand a process in an unknown state to the next task.
+            current.close()
+            throw t
+        }
+        synchronized(idle) { idle.addLast(current) }
+        return result
+    }
+
+    private suspend fun takeIdle(): KrapperProcess? {
+        while (true) {
+            val process = synchronized(idle) { idle.removeLastOrNull() } ?: return null
+            if (process.isAlive()) {
+                return process
+            }
+            process.close()
+        }
+    }
+
+    override fun close() {
+        val processes = synchronized(idle) { idle.toList().also { idle.clear() } }
+        for (process in processes) {
+            KrapperProcessPool.release(
+                process,
+                parameters.idleTimeoutSeconds.getOrElse(DEFAULT_IDLE_TIMEOUT_SECONDS)
+            )
+        }
+    }
+
+    companion object {
+        const val NAME = "krapperGen"
+        const val IDLE_TIMEOUT_PROPERTY = "kplusplus.daemonIdleTimeoutSeconds"
+        const val DEFAULT_IDLE_TIMEOUT_SECONDS = 600L
+    }
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.monkopedia.kplusplus
+
+import com.monkopedia.krapper.IndexRequest
+import com.monkopedia.krapper.KrapperConfig
+import com.monkopedia.krapper.KrapperService
+import com.monkopedia.krapper.MappingService
+import com.monkopedia.krapper.RemoteLogger
+import java.util.UUID
+import java.util.concurrent.ConcurrentHashMap
+import kotlinx.coroutines.runBlocking
+import kotlinx.serialization.json.Json
+import org.gradle.api.file.ConfigurableFileCollection
+import org.gradle.api.file.DirectoryProperty
+import org.gradle.api.file.RegularFileProperty
+import org.gradle.api.provider.Property
+import org.gradle.workers.WorkAction
+import org.gradle.workers.WorkParameters
+
+/**
+ * Runs one import against krapper_gen from a Gradle worker, so imports in the same project
+ * don't wait on each other. Each step is optional: the model is either parsed or imported,
+ * then exported and/or used to generate the wrappers.
+ */
+abstract class KrapperWorkAction : WorkAction<KrapperWorkAction.Params> {
+    interface Params : WorkParameters {
+        val krapperService: Property<KrapperGenService>
+
+        /**
+         * [KrapperConfig] for the request, as JSON.
+         */
+        val config: Property<String>
+        val headers: ConfigurableFileCollection
+        val libraries: ConfigurableFileCollection
+        val classFilter: Property<String>
+        val importModel: RegularFileProperty
+        val exportModel: RegularFileProperty
+        val outputDirectory: DirectoryProperty
+
+        /**
+         * Key of the mappings to apply in [PendingMappings].
+         */
+        val mappings: Property<String>
+    }
+
+    override fun execute() = runKrapper { service ->
+        val params = parameters
+        val mappings = params.mappings.orNull?.let(PendingMappings::take).orEmpty()
+        val request = IndexRequest(
+            params.headers.files.map { it.absolutePath },
+            params.libraries.files.map { it.absolutePath }
+        )
+        println("Requesting index $request")
+        val index = service.index(request)
+        if (params.importModel.isPresent) {
+            println("Loading shared model")
+            index.importModel(params.importModel.get().asFile.absolutePath)
+        } else {
+            println("Filtering")
+            index.filterAndResolve(Fingerprints.parseFilter(params.classFilter.get()))
+            val report = index.resolutionReport(Unit)
+            println(
+                "Resolved ${report.resolved.size} classes, dropped ${report.dropped.size} " +
+                    "references, included ${report.included.size} missing classes"
+            )
+        }
+        if (params.exportModel.isPresent) {
+            index.exportModel(params.exportModel.get().asFile.absolutePath)
+        }
+        if (params.outputDirectory.isPresent) {
+            for (mapping in mappings) {
+                println("Adding mapping")
+                index.addMapping(mapping)
+            }
+            println("Writing output")
+            index.writeTo(params.outputDirectory.get().asFile.absolutePath)
+        }
+        println("Closing index")
+        try {
+            index.close()
+        } catch (t: Throwable) {
+        }
+    }
+
+    private fun runKrapper(execute: suspend (KrapperService) -> Unit) = try {
+        runBlocking {
+            parameters.krapperService.get().withService { service ->
+                val config =
+                    Json.decodeFromString(KrapperConfig.serializer(), parameters.config.get())
+                service.setLogger(PrintLogger)
+                service.setConfig(
+                    config.also {
+                        println("Setting krapper config to $it")
+                    }
+                )
+                execute(service)
+            }
+        }
+        println("Done with service")
+    } catch (t: Throwable) {
+        throw RuntimeException("Problem executing krapper: ${t.message}", t)
+    }
+
+    private object PrintLogger : RemoteLogger {
+        override suspend fun e(message: String) {
+            println(message)
+        }
+
+        override suspend fun i(message: String) {
+            println(message)
+        }
+
+        override suspend fun w(message: String) {
+            println(message)
+        }
+    }
+}
+
+/**
+ * Hands mappings from a task to its [KrapperWorkAction]. Mappings call back into build script
+ * code so they can't be serialized into the work parameters, instead the action picks them up
+ * by key. This needs the actions to run in the build's own JVM, in the same build that
+ * configured the task, which is why the work isn't process isolated and why tasks with
+ * mappings opt out of the configuration cache.
+ */
+internal object PendingMappings {
+    private val pending = ConcurrentHashMap<String, List<MappingService>>()
+
+    fun put(owner: String, mappings: List<MappingService>): String =
+        "$owner#${UUID.randomUUID()}".also { pending[it] = mappings }
+
+    fun take(key: String): List<MappingService> = pending.remove(key) ?: error(
+        "Mappings for ${key.substringBefore('#')} aren't available. They can only be handed to " +
+            "work queued by the build that configured the task, not restored from a cache."
+    )
+}
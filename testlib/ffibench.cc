@@ -0,0 +1,90 @@
+// Hand written baseline for the FFI benchmarks in testlib_kotlin (FfiBench.kt), making the same
+// calls directly from C++ so the binding overhead can be read off the difference.
+//
+//   clang++ -O2 -o ffibench ffibench.cc -L. -ltestlib && ./ffibench
+#include "testlib.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+using namespace std;
+using namespace TestLib;
+
+static long allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* ptr = malloc(size);
+    if (!ptr) throw bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+static const long ITERATIONS = 1000000;
+
+// Keeps results alive so the calls aren't optimized away.
+static volatile long sink = 0;
+
+// Makes the compiler assume *ptr is read, so stores to it and inline calls on it stay.
+template <typename T>
+static void escape(T* ptr) {
+    asm volatile("" : : "g"(ptr) : "memory");
+}
+
+template <typename F>
+static void bench(const char* name, F call) {
+    for (long i = 0; i < ITERATIONS / 10; i++) call();
+    long startAllocations = allocations;
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < ITERATIONS; i++) call();
+    auto end = chrono::steady_clock::now();
+    double ns = chrono::duration<double, nano>(end - start).count();
+    printf("%s\t%.2f\t%.2f\n", name, ns / ITERATIONS,
+            (double) (allocations - startAllocations) / ITERATIONS);
+}
+
+int main() {
+    TestClass c1, c2;
+    OtherClass other;
+    other.setPrivateString("Prefix: ");
+    string key = "something";
+    char str[] = "My test string";
+
+    printf("case\tns/call\tallocations/call\n");
+    // The DIRECT wrapper allocates with new, escaping keeps the pair from being elided.
+    bench("constructor DIRECT", [&]() {
+        TestClass* c = new TestClass();
+        escape(c);
+        sink += c->i;
+        delete c;
+    });
+    bench("constructor STACK", [&]() { StackOnly s(1); sink += s.value; });
+    bench("return VOID, args NATIVE", [&]() { c1.setSome(1, 2, 3); });
+    bench("return RETURN", [&]() { sink += c1.sum(); });
+    bench("return STRING", [&]() { sink += other.getPrivateString().size(); });
+    bench("return ARG_CAST", [&]() { TestClass r = c1 - c2; sink += r.i; });
+    bench("return COPY_CONSTRUCTOR", [&]() { sink += c1.immutable().get(); });
+    bench("return RETURN_REFERENCE", [&]() { sink += c1.intRef(); });
+    bench("arg STRING", [&]() { other.setPrivateString("Prefix: "); });
+    bench("arg STD_MOVE", [&]() { sink += c1.adopt(unique_ptr<TestClass>()); });
+    bench("arg REINT_CAST", [&]() { c1.setPrivateFrom(&other); });
+    bench("arg RAW_CAST", [&]() { c1.setLongDouble(1.0); escape(&c1); });
+    bench("field get", [&]() { sink += c1.i; });
+    bench("field set", [&]() { c1.i = 5; escape(&c1); });
+    bench("field set char*", [&]() { c1.str = str; escape(&c1); });
+    bench("operator plus", [&]() { TestClass r = c1 + c2; sink += r.i; });
+    bench("operator eq", [&]() { TestClass r = c1 == c2; sink += r.i; });
+    bench("operator index", [&]() { TestClass r = c1[key]; sink += r.i; });
+    bench("operator preinc", [&]() { TestClass r = ++c1; sink += r.i; });
+    return 0;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -23,6 +24,26 @@ T MyPair<T>::getMax ()
   return retval;
 }
 
+// Defined inline so the benchmarks can use them without rebuilding libtestlib.a.
+
+// Not assignable, so returning it by value goes through the copy constructor.
+class Immutable {
+    private:
+        const int value;
+    public:
+        Immutable(int v) : value(v) {}
+        int get() { return value; }
+};
+
+// Can't be allocated with new, so it is only constructed on the stack.
+class StackOnly {
+    private:
+        static void* operator new(size_t size);
+    public:
+        int value;
+        StackOnly(int v) : value(v) {}
+};
+
 class OtherClass {
     private:
         std::string privateString;
@@ -87,6 +108,12 @@ class TestClass {
  
         void output();
 
+        int& intRef() { return i; }
+        void setLongDouble(long double value) { ld = value; }
+        Immutable immutable() { return Immutable(i); }
+        // Takes ownership by value, so the wrapper has to std::move the argument in.
+        int adopt(std::unique_ptr<TestClass> value) { return value ? value->i : -1; }
+
         // Operator overloading
         TestClass operator-(TestClass c2);
         TestClass operator-();
@@ -43,6 +43,10 @@ kotlin {
     hostTarget.apply {
         binaries {
             executable()
+            // FFI overhead microbenchmarks, compare with testlib/ffibench.cc.
+            executable("ffiBench", listOf(RELEASE)) {
+                entryPoint = "ffiBenchMain"
+            }
         }
         compilations["main"].cinterops {
             this.create("testlib") {
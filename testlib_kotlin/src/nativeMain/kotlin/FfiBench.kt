@@ -0,0 +1,104 @@
+/*
+ * Copyright 2022 Jason Monk
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+import TestLib.OtherClass.Companion.OtherClass
+import TestLib.StackOnly.Companion.StackOnly
+import TestLib.TestClass.Companion.TestClass
+import kotlin.math.round
+import kotlin.native.runtime.GC
+import kotlin.native.runtime.NativeRuntimeApi
+import kotlin.time.TimeSource
+import kotlinx.cinterop.cstr
+import kotlinx.cinterop.memScoped
+import std.Unique_ptr__TestClass.Companion.Unique_ptr__TestClass
+
+private const val ITERATIONS = 1_000_000
+
+// Keeps results alive so the calls aren't optimized away.
+private var sink = 0L
+
+/**
+ * Times [call] over [ITERATIONS] runs and prints the time and Kotlin heap bytes allocated per
+ * call, in the same format as the C++ baseline in testlib/ffibench.cc. Native allocations made
+ * by the wrappers aren't visible here, the baseline counts those for the C++ side.
+ */
+@OptIn(NativeRuntimeApi::class)
+private inline fun bench(name: String, call: () -> Unit) {
+    repeat(ITERATIONS / 10) { call() }
+    GC.collect()
+    val startInfo = GC.lastGCInfo
+    val mark = TimeSource.Monotonic.markNow()
+    repeat(ITERATIONS) { call() }
+    val elapsed = mark.elapsedNow()
+    GC.collect()
+    val endInfo = GC.lastGCInfo
+    // Bytes are only known when no other collection ran during the loop.
+    val bytes = if (endInfo != null && startInfo != null && endInfo.epoch == startInfo.epoch + 1) {
+        val before = startInfo.memoryUsageAfter.values.sumOf { it.totalObjectsSizeBytes }
+        val after = endInfo.memoryUsageBefore.values.sumOf { it.totalObjectsSizeBytes }
+        ((after - before).toDouble() / ITERATIONS).twoPlaces()
+    } else {
+        "?"
+    }
+    val ns = elapsed.inWholeNanoseconds.toDouble() / ITERATIONS
+    println("$name\t${ns.twoPlaces()}\t$bytes")
+}
+
+private fun Double.twoPlaces(): String {
+    val scaled = round(this * 100).toLong()
+    return "${scaled / 100}.${(scaled % 100).toString().padStart(2, '0')}"
+}
+
+/**
+ * Calls the generated testlib wrappers in tight loops, covering each return style, argument
+ * cast, field access, operators and both constructor styles.
+ */
+fun ffiBenchMain(args: Array<String>) {
+    memScoped {
+        val c1 = TestClass()
+        val c2 = TestClass()
+        val other = OtherClass()
+        other.setPrivateString("Prefix: ")
+        val key = "something"
+        val str = "My test string".cstr.getPointer(this)
+
+        println("case\tns/call\tbytes/call")
+        bench("constructor DIRECT") { memScoped { sink += TestClass().i } }
+        bench("constructor STACK") { memScoped { StackOnly(1) { sink += it.value } } }
+        bench("return VOID, args NATIVE") { c1.setSome(1, 2, 3) }
+        bench("return RETURN") { sink += c1.sum() }
+        bench("return STRING") { sink += other.getPrivateString()?.length ?: 0 }
+        bench("return ARG_CAST") { memScoped { sink += (c1 - c2).i } }
+        bench("return COPY_CONSTRUCTOR") { memScoped { sink += c1.immutable().get() } }
+        bench("return RETURN_REFERENCE") { sink += c1.intRef() }
+        bench("arg STRING") { other.setPrivateString("Prefix: ") }
+        // An empty pointer, so only the move into the by-value parameter is timed.
+        bench("arg STD_MOVE") { memScoped { sink += c1.adopt(Unique_ptr__TestClass()) } }
+        bench("arg REINT_CAST") { c1.setPrivateFrom(other) }
+        bench("arg RAW_CAST") { c1.setLongDouble(1.0) }
+        bench("field get") { sink += c1.i }
+        bench("field set") { c1.i = 5 }
+        bench("field set char*") { c1.str = str }
+        bench("operator plus") { memScoped { sink += (c1 + c2).i } }
+        bench("operator eq") { memScoped { sink += (c1 eq c2).i } }
+        bench("operator index") { memScoped { sink += c1[key].i } }
+        bench("operator preinc") {
+            memScoped {
+                var c = c1
+                sink += (++c).i
+            }
+        }
+    }
+}